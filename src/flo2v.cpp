@@ -7,33 +7,89 @@
 
 #include "version.h"
 #include "libflo2v/generation.hpp"
+#include "libflo2v/reader.hpp"
+#include "libflo2v/slice.hpp"
+#include "libflo2v/timing.hpp"
 
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <sstream>
+#include <thread>
 
 using namespace libflo;
 
 static void print_help(const char *prog_name)
 {
-    std::cerr << prog_name << " (--version | <flo>):"
-              << " generate verilog from a flo file\n";
+    std::cerr << prog_name << " (--version | [options] <flo>):"
+              << " generate verilog from a flo file\n"
+              << "  --native       read the flo without libflo\n"
+              << "  --cross-check  read the flo both ways and compare\n"
+              << "  --threads <n>  threads for the native reader\n"
+              << "  --keep-outputs <list>  only generate the logic feeding"
+              << " these outputs\n"
+              << "  --dedup        emit repeated logic once as a"
+              << " submodule\n"
+              << "  --timing-report[=<n>]  print the n (default 10)"
+              << " deepest paths and highest fanouts\n"
+              << "  --timing-json <file>   also write the report as JSON\n";
 }
 
 int main(int argc, char *argv[])
 {
     const struct option long_options[] = {
         {"version", 0, NULL, 'v'},
+        {"native", 0, NULL, 'n'},
+        {"cross-check", 0, NULL, 'c'},
+        {"threads", 1, NULL, 't'},
+        {"keep-outputs", 1, NULL, 'k'},
+        {"dedup", 0, NULL, 'd'},
+        {"timing-report", 2, NULL, 'r'},
+        {"timing-json", 1, NULL, 'j'},
         {NULL, 0, NULL, 0}
     };
     int opt;
     bool version = false;
+    bool native = false;
+    bool cross_check = false;
+    size_t threads = std::thread::hardware_concurrency();
+    std::vector<std::string> keep_outputs;
+    bool dedup = false;
+    size_t timing_top = 0;
+    std::string timing_json;
 
     while ((opt = getopt_long(argc, argv, "", long_options, NULL)) > 0) {
+        std::stringstream list;
+        std::string item;
+
         switch (opt) {
         case 'v':
             version = true;
             break;
+        case 'n':
+            native = true;
+            break;
+        case 'c':
+            cross_check = true;
+            break;
+        case 't':
+            threads = strtoul(optarg, NULL, 10);
+            break;
+        case 'd':
+            dedup = true;
+            break;
+        case 'r':
+            timing_top = optarg ? strtoul(optarg, NULL, 10) : 10;
+            break;
+        case 'j':
+            timing_json = optarg;
+            break;
+        case 'k':
+            list.str(optarg);
+            while (std::getline(list, item, ','))
+                if (item != "")
+                    keep_outputs.push_back(item);
+            break;
         default:
             print_help(argv[0]);
             exit(EXIT_FAILURE);
@@ -64,8 +120,39 @@ int main(int argc, char *argv[])
 
     outpath.replace(dotpos, 4, ".v");
 
-    auto flof = flo<node, operation<node> >::parse(argv[optind]);
+    std::shared_ptr<flo2v::ir::graph> flof;
+    if (native || cross_check)
+        flof = flo2v::read_flo(argv[optind], threads);
+
+    if (!native || cross_check) {
+        auto libflof = flo2v::ir::graph::from_libflo(
+                flo<node, operation<node> >::parse(argv[optind]));
+
+        if (cross_check && !flo2v::ir::cross_check(*libflof, *flof,
+                                                   std::cerr)) {
+            std::cerr << "Native reader disagrees with libflo\n";
+            exit(EXIT_FAILURE);
+        }
+
+        flof = libflof;
+    }
+
+    if (!keep_outputs.empty())
+        flof = flo2v::slice_outputs(*flof, keep_outputs);
+
+    if (timing_json != "" && timing_top == 0)
+        timing_top = 10;
+
+    if (timing_top > 0) {
+        auto report = flo2v::analyze_timing(*flof, timing_top);
+        flo2v::print_timing(*flof, report, std::cout);
+        if (timing_json != "") {
+            std::ofstream jstream(timing_json.c_str());
+            flo2v::print_timing_json(*flof, report, jstream);
+        }
+    }
+
     std::ofstream vstream(outpath.c_str());
 
-    flo2v::gen_flo(flof, vstream);
+    flo2v::gen_flo(flof, vstream, dedup);
 }
@@ -0,0 +1,266 @@
+#include "dedup.hpp"
+#include "helpers.hpp"
+
+#include <unordered_map>
+
+using namespace libflo;
+
+namespace flo2v {
+    // the smallest group that's worth turning into a module
+    static const size_t min_group_ops = 2;
+
+    /* The hierarchy a net lives in, ie. its name up to the last colon.
+     * Nets directly in the top module have no prefix of their own. */
+    static std::string hierarchy_prefix(const std::string &name)
+    {
+        auto last = name.rfind(':');
+        if (last == std::string::npos)
+            return "";
+        auto end = name.find_last_not_of(':', last);
+        if (end == std::string::npos)
+            return "";
+        auto prefix = name.substr(0, end + 1);
+        if (prefix.find(':') == std::string::npos)
+            return "";
+        return prefix;
+    }
+
+    static bool dedupable(opcode op)
+    {
+        switch (op) {
+        case opcode::IN:
+        case opcode::OUT:
+        case opcode::MEM:
+        case opcode::RD:
+        case opcode::WR:
+        case opcode::INIT:
+            return false;
+        default:
+            return true;
+        }
+    }
+
+    /* A group of operations in canonical form.  Operands are written as
+     * L<n> for the net driven by the group's n-th operation, E<n> for the
+     * n-th distinct net from outside the group, or the constant itself. */
+    struct group {
+        std::string prefix;
+        std::vector<size_t> ops;
+        std::vector<ir::node_id> externals;
+        std::string canonical;
+    };
+
+    static void canonicalize(const ir::graph &flof, group &g)
+    {
+        const auto &ops = flof.operations();
+        std::unordered_map<ir::node_id, size_t> locals;
+        std::unordered_map<ir::node_id, size_t> externals;
+
+        for (size_t k = 0; k < g.ops.size(); k++)
+            locals[ops[g.ops[k]].arg_id(0)] = k;
+
+        for (const auto i : g.ops) {
+            const auto &op = ops[i];
+            g.canonical += ir::opcode_name(op.op());
+            g.canonical += "/" + std::to_string(op.d()->width());
+
+            for (size_t a = 1; a < op.argc(); a++) {
+                auto id = op.arg_id(a);
+                const auto &n = flof.at(id);
+                if (n.is_const()) {
+                    g.canonical += " " + n.name() + "/"
+                        + (n.known_width() ? std::to_string(n.width()) : "?");
+                    continue;
+                }
+
+                auto local = locals.find(id);
+                if (local != locals.end()) {
+                    g.canonical += " L" + std::to_string(local->second);
+                    continue;
+                }
+
+                auto ext = externals.find(id);
+                if (ext == externals.end()) {
+                    ext = externals.insert(
+                            std::make_pair(id, g.externals.size())).first;
+                    g.externals.push_back(id);
+                }
+                g.canonical += " E" + std::to_string(ext->second)
+                    + "/" + std::to_string(n.width());
+            }
+            g.canonical += ";";
+        }
+    }
+
+    /* Builds the module for a structure from its first occurrence. */
+    static std::shared_ptr<ir::graph> build_body(
+            const ir::graph &flof, const group &g,
+            const std::string &name, const std::vector<size_t> &exported,
+            std::vector<ir::node_id> &locals)
+    {
+        const auto &ops = flof.operations();
+        std::shared_ptr<ir::graph> body(new ir::graph());
+        std::unordered_map<ir::node_id, ir::node_id> remap;
+
+        for (size_t j = 0; j < g.externals.size(); j++) {
+            const auto &n = flof.at(g.externals[j]);
+            auto id = body->add_node(ir::node(
+                    name + "::i" + std::to_string(j), n.width(), true,
+                    false, false, 0));
+            remap[g.externals[j]] = id;
+            body->add_operation(opcode::IN,
+                                std::vector<ir::node_id>(1, id));
+        }
+
+        for (size_t k = 0; k < g.ops.size(); k++) {
+            const auto &n = *ops[g.ops[k]].d();
+            remap[ops[g.ops[k]].arg_id(0)] = body->add_node(ir::node(
+                    name + "::n" + std::to_string(k), n.width(),
+                    n.known_width(), false, false, 0));
+            locals.push_back(remap[ops[g.ops[k]].arg_id(0)]);
+        }
+
+        std::vector<ir::node_id> args;
+        for (const auto i : g.ops) {
+            args.clear();
+            for (size_t a = 0; a < ops[i].argc(); a++) {
+                auto id = ops[i].arg_id(a);
+                const auto &n = flof.at(id);
+                if (n.is_const())
+                    args.push_back(body->add_node(n));
+                else
+                    args.push_back(remap[id]);
+            }
+            body->add_operation(ops[i].op(), args);
+        }
+
+        for (size_t e = 0; e < exported.size(); e++) {
+            auto local = remap[ops[g.ops[exported[e]]].arg_id(0)];
+            auto out = body->add_node(ir::node(
+                    name + "::o" + std::to_string(e),
+                    body->at(local).width(), true, false, false, 0));
+            std::vector<ir::node_id> out_args;
+            out_args.push_back(out);
+            out_args.push_back(local);
+            body->add_operation(opcode::OUT, out_args);
+        }
+
+        return body;
+    }
+
+    dedup_plan find_duplicates(const ir::graph &flof,
+                               const std::string &mod_name)
+    {
+        const auto &ops = flof.operations();
+        dedup_plan plan;
+        plan.covered.assign(ops.size(), false);
+
+        // group the operations by the hierarchy of the net they drive
+        std::vector<group> groups;
+        std::unordered_map<std::string, size_t> by_prefix;
+        for (size_t i = 0; i < ops.size(); i++) {
+            if (!dedupable(ops[i].op()))
+                continue;
+            auto prefix = hierarchy_prefix(ops[i].d()->name());
+            if (prefix == "")
+                continue;
+
+            auto it = by_prefix.find(prefix);
+            if (it == by_prefix.end()) {
+                it = by_prefix.insert(
+                        std::make_pair(prefix, groups.size())).first;
+                groups.push_back(group());
+                groups.back().prefix = prefix;
+            }
+            groups[it->second].ops.push_back(i);
+        }
+
+        // bucket the groups by their canonical form, in the order the
+        // structures first appear
+        std::unordered_map<std::string, size_t> by_form;
+        std::vector<std::vector<size_t> > matches;
+        for (size_t i = 0; i < groups.size(); i++) {
+            if (groups[i].ops.size() < min_group_ops)
+                continue;
+            canonicalize(flof, groups[i]);
+
+            auto it = by_form.find(groups[i].canonical);
+            if (it == by_form.end()) {
+                by_form[groups[i].canonical] = matches.size();
+                matches.push_back(std::vector<size_t>(1, i));
+            } else {
+                matches[it->second].push_back(i);
+            }
+        }
+
+        // work out which operation drives each net, and which group (if
+        // any) each operation ends up in
+        std::vector<size_t> owner(ops.size(), (size_t) -1);
+        for (size_t m = 0; m < matches.size(); m++) {
+            if (matches[m].size() < 2)
+                continue;
+            for (const auto g : matches[m]) {
+                for (const auto i : groups[g].ops)
+                    owner[i] = g;
+            }
+        }
+
+        // a net has to be a port if anything outside its group reads it
+        std::vector<size_t> driver_group(flof.nodes().size(), (size_t) -1);
+        for (size_t i = 0; i < ops.size(); i++) {
+            if (owner[i] != (size_t) -1)
+                driver_group[ops[i].arg_id(0)] = owner[i];
+        }
+        std::vector<bool> read_outside(flof.nodes().size(), false);
+        for (size_t i = 0; i < ops.size(); i++) {
+            for (size_t a = 1; a < ops[i].argc(); a++) {
+                auto id = ops[i].arg_id(a);
+                if (driver_group[id] != (size_t) -1
+                    && driver_group[id] != owner[i])
+                    read_outside[id] = true;
+            }
+        }
+
+        for (size_t m = 0; m < matches.size(); m++) {
+            if (matches[m].size() < 2)
+                continue;
+
+            // every occurrence gets the same ports, so export a net if
+            // any occurrence needs it
+            const auto &first = groups[matches[m][0]];
+            std::vector<size_t> exported;
+            for (size_t k = 0; k < first.ops.size(); k++) {
+                for (const auto g : matches[m]) {
+                    if (read_outside[ops[groups[g].ops[k]].arg_id(0)]) {
+                        exported.push_back(k);
+                        break;
+                    }
+                }
+            }
+
+            dedup_structure structure;
+            auto name = mod_name + "_dedup" +
+                std::to_string(plan.structures.size());
+            structure.body = build_body(flof, first, name, exported,
+                                        structure.locals);
+
+            for (const auto g : matches[m]) {
+                dedup_instance inst;
+                ir::node prefix(groups[g].prefix, 0, false, false, false, 0);
+                inst.name = node_name(&prefix) + "_inst";
+                inst.inputs = groups[g].externals;
+                for (const auto k : exported)
+                    inst.outputs.push_back(ops[groups[g].ops[k]].arg_id(0));
+                for (const auto i : groups[g].ops) {
+                    inst.locals.push_back(ops[i].arg_id(0));
+                    plan.covered[i] = true;
+                }
+                structure.instances.push_back(inst);
+            }
+
+            plan.structures.push_back(structure);
+        }
+
+        return plan;
+    }
+}
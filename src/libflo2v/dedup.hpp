@@ -0,0 +1,48 @@
+#ifndef FLO2V_DEDUP_H
+#define FLO2V_DEDUP_H
+
+#include "ir.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace flo2v {
+    /* One occurrence of a repeated structure: the parent's nets that
+     * drive its inputs and that its outputs drive, in port order, and
+     * every net of the parent's that the occurrence drives. */
+    struct dedup_instance {
+        std::string name;
+        std::vector<ir::node_id> inputs;
+        std::vector<ir::node_id> outputs;
+        std::vector<ir::node_id> locals;
+    };
+
+    /* A structure that occurs more than once, as a graph of its own whose
+     * ports are named i<n> and o<n>.  The n-th local of an instance lives
+     * on inside it as the n-th of the body's locals. */
+    struct dedup_structure {
+        std::shared_ptr<ir::graph> body;
+        std::vector<ir::node_id> locals;
+        std::vector<dedup_instance> instances;
+    };
+
+    struct dedup_plan {
+        std::vector<dedup_structure> structures;
+        // the parent's operations that have moved into a structure
+        std::vector<bool> covered;
+    };
+
+    /**
+     * Finds logic that Chisel has flattened from repeated instances of a
+     * submodule.  Operations are grouped by the hierarchy prefix of the
+     * net they drive, and each group is reduced to a canonical form in
+     * which nets are numbered by position rather than named; groups whose
+     * canonical forms hash (and compare) equal share a structure.  Ports
+     * and memory operations always stay in the parent.
+     */
+    dedup_plan find_duplicates(const ir::graph &flof,
+                               const std::string &mod_name);
+}
+
+#endif
@@ -1,7 +1,11 @@
 #include "generation.hpp"
 #include "helpers.hpp"
+#include "dedup.hpp"
 
+#include <libstep/exceptions.hpp>
+#include <fnmatch.h>
 #include <iostream>
+#include <unordered_map>
 
 using namespace libflo;
 
@@ -245,14 +249,42 @@ namespace flo2v {
                 << node_name(dest);
     }
 
-    void gen_flo(std::shared_ptr<flo<node, operation<node> > > flof,
-                 std::ostream &out)
+    static void gen_instance(std::ostream &out, const ir::graph &flof,
+            const std::string &mod_name, const dedup_structure &structure,
+            const dedup_instance &inst)
     {
-        auto mod_name = class_name(flof);
+        auto sub_name = class_name(*structure.body);
+
+        out << sub_name << " " << inst.name << " (\n"
+            << "\t." << sub_name << "_clk (" << mod_name << "_clk),\n"
+            << "\t." << sub_name << "_reset (" << mod_name << "_reset)";
+        for (size_t i = 0; i < inst.inputs.size(); i++)
+            out << ",\n\t.i" << i << " ("
+                << node_name(&flof.at(inst.inputs[i])) << ")";
+        for (size_t i = 0; i < inst.outputs.size(); i++)
+            out << ",\n\t.o" << i << " ("
+                << node_name(&flof.at(inst.outputs[i])) << ")";
+        out << "\n);\n";
+    }
+
+    void gen_flo(std::shared_ptr<ir::graph> flof,
+                 std::ostream &out, bool dedup)
+    {
+        auto mod_name = class_name(*flof);
         if (mod_name == "") {
             fprintf(stderr, "Could not find class name");
         }
 
+        // repeated structures become modules of their own, which have to
+        // be generated before the module that instantiates them
+        dedup_plan plan;
+        if (dedup) {
+            plan = find_duplicates(*flof, mod_name);
+            for (const auto &structure : plan.structures)
+                gen_flo(structure.body, out, false);
+        }
+        plan.covered.resize(flof->operations().size(), false);
+
         auto clk_name = mod_name + "_clk";
         auto reset_name = mod_name + "_reset";
 
@@ -270,28 +302,31 @@ namespace flo2v {
         // print the ports (inputs and outputs)
         // and sort the categories
         for (const auto& op : flof->operations()) {
-            switch (op->op()) {
+            if (plan.covered[&op - &flof->operations()[0]])
+                continue;
+
+            switch (op.op()) {
             // ignore memories
             case opcode::MEM:
                 break;
             case opcode::IN:
-                gen_inout(out, "input", op->d());
+                gen_inout(out, "input", op.d());
                 break;
             case opcode::OUT:
-                gen_inout(out, "output", op->d());
-                outputs.push_back(op);
+                gen_inout(out, "output", op.d());
+                outputs.push_back(&op);
                 break;
             case opcode::REG:
-                registers.push_back(op);
+                registers.push_back(&op);
                 break;
             case opcode::WR:
-                writes.push_back(op);
+                writes.push_back(&op);
                 break;
             case opcode::INIT:
-                inits.push_back(op);
+                inits.push_back(&op);
                 break;
             default:
-                wires.push_back(op);
+                wires.push_back(&op);
             }
         }
 
@@ -299,10 +334,10 @@ namespace flo2v {
 
         // generate all the memories first
         for (const auto& node : flof->nodes()) {
-            if (!node->is_mem())
+            if (!node.is_mem())
                 continue;
 
-            gen_mem(out, node);
+            gen_mem(out, &node);
         }
 
         for (const auto& op : registers)
@@ -311,6 +346,19 @@ namespace flo2v {
         for (const auto& op : wires)
             gen_decl(out, "wire", op->d());
 
+        // nets driven by instances of a repeated structure
+        for (const auto &structure : plan.structures) {
+            for (const auto &inst : structure.instances) {
+                for (const auto id : inst.outputs)
+                    gen_decl(out, "wire", &flof->at(id));
+            }
+        }
+
+        for (const auto &structure : plan.structures) {
+            for (const auto &inst : structure.instances)
+                gen_instance(out, *flof, mod_name, structure, inst);
+        }
+
         // generate all the combination statements
         for (const auto& op : wires)
             gen_wire(out, op, reset_name);
@@ -335,41 +383,198 @@ namespace flo2v {
         out << "end\nendmodule\n";
     }
 
-    /* Generate $dumpvars expression for inputs and outputs */
+    /* Generate $dumpvars expression for the selected nets */
     static void gen_vardump(std::ostream &out,
-            std::string mod_name, std::vector<nodeptr> &ports)
+            const std::vector<std::string> &paths)
     {
         out << "\t$dumpvars(1";
-        for (const auto &node : ports)
-            out << ", " << mod_name << "." << node_name(node);
+        for (const auto &path : paths)
+            out << ", " << path;
         out << ");\n\t";
     }
 
-    void gen_step(std::shared_ptr<flo<node, operation<node> > > flof,
-                  std::shared_ptr<libstep::step> stepf, size_t clock_period,
-                  std::ostream &out)
+    static bool dump_selected(const dump_options &dump, nodeptr node)
     {
-        std::string mod_name = class_name(flof);
-        std::string clk_name = mod_name + "_clk";
-        std::string reset_name = mod_name + "_reset";
+        if (dump.signals.empty())
+            return true;
+
+        auto vname = node_name(node);
+        auto fname = node->name();
+        for (const auto &pattern : dump.signals) {
+            if (fnmatch(pattern.c_str(), vname.c_str(), 0) == 0)
+                return true;
+            if (fnmatch(pattern.c_str(), fname.c_str(), 0) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    static bool in_window(const dump_options &dump, size_t cycle)
+    {
+        if (dump.windows.empty())
+            return true;
+
+        for (const auto &window : dump.windows) {
+            if (window.first <= cycle && cycle < window.second)
+                return true;
+        }
+        return false;
+    }
+
+    /* The first window edge strictly after the given cycle, or 0 if there
+     * are none left. */
+    static size_t next_window_edge(const dump_options &dump, size_t cycle)
+    {
+        size_t edge = 0;
+        for (const auto &window : dump.windows) {
+            if (window.first > cycle && (edge == 0 || window.first < edge))
+                edge = window.first;
+            if (window.second > cycle && (edge == 0 || window.second < edge))
+                edge = window.second;
+        }
+        return edge;
+    }
+
+    std::vector<const ir::node *> dumped_nets(const ir::graph &flof,
+                                              const dump_options &dump)
+    {
+        std::vector<nodeptr> ports;
+        std::vector<nodeptr> internals;
+
+        for (const auto &op : flof.operations()) {
+            switch (op.op()) {
+            case opcode::IN:
+            case opcode::OUT:
+                ports.push_back(op.d());
+                break;
+            // these don't declare a net in the generated module
+            case opcode::MEM:
+            case opcode::WR:
+            case opcode::INIT:
+                break;
+            default:
+                internals.push_back(op.d());
+            }
+        }
+
+        std::vector<nodeptr> dumped;
+        for (const auto &node : ports) {
+            if (dump_selected(dump, node))
+                dumped.push_back(node);
+        }
+        if (dump.internal) {
+            for (const auto &node : internals) {
+                if (dump_selected(dump, node))
+                    dumped.push_back(node);
+            }
+        }
+        return dumped;
+    }
+
+    /* The hierarchical names of the dumped nets.  A net that --dedup
+     * moved into an instance of a repeated structure, and that isn't one
+     * of the instance's outputs, only exists inside that instance. */
+    static std::vector<std::string> dump_paths(const ir::graph &flof,
+            const std::string &mod_name, const dump_options &dump)
+    {
+        std::unordered_map<ir::node_id, std::string> hidden;
+        if (dump.dedup) {
+            auto plan = find_duplicates(flof, mod_name);
+            for (const auto &structure : plan.structures) {
+                for (const auto &inst : structure.instances) {
+                    for (size_t k = 0; k < inst.locals.size(); k++) {
+                        auto local = &structure.body->at(structure.locals[k]);
+                        hidden[inst.locals[k]] =
+                            inst.name + "." + node_name(local);
+                    }
+                    for (const auto id : inst.outputs)
+                        hidden.erase(id);
+                }
+            }
+        }
+
+        std::vector<std::string> paths;
+        for (const auto &node : dumped_nets(flof, dump)) {
+            auto it = hidden.find(flof.id(node));
+            paths.push_back(mod_name + "." +
+                    (it == hidden.end() ? node_name(node) : it->second));
+        }
+        return paths;
+    }
+
+    /* Writes a testbench for a flo module, taking the step actions that
+     * drive it one at a time so either kind of step file can feed it. */
+    class tb_writer {
+        protected:
+            std::ostream &_out;
+            std::string _mod_name;
+            const size_t _clock_period;
+            const dump_options &_dump;
+            const std::set<std::string> &_dropped;
+            std::map<std::string, unsigned int> _sizemap;
+            std::vector<std::string> _dumped;
+            bool _dump_scope;
+            // cycles are counted over step actions, and are what the dump
+            // windows are measured against
+            size_t _cycle;
+            bool _dump_started;
+            bool _dump_on;
+        public:
+            tb_writer(std::shared_ptr<ir::graph> flof,
+                      size_t clock_period, std::ostream &out,
+                      const dump_options &dump,
+                      const std::set<std::string> &dropped);
+            /* Inputs that slicing removed have a width of 0, and pokes to
+             * them are dropped.  Any other input the module doesn't have
+             * is an error. */
+            unsigned int width(const std::string &signal);
+            void step(size_t cycles);
+            void poke(const std::string &signal, const std::string &literal);
+            void reset(size_t cycles);
+            void quit(void);
+            void close(void);
+    };
+
+    tb_writer::tb_writer(std::shared_ptr<ir::graph> flof,
+                         size_t clock_period, std::ostream &out,
+                         const dump_options &dump,
+                         const std::set<std::string> &dropped)
+        : _out(out),
+          _mod_name(class_name(*flof)),
+          _clock_period(clock_period),
+          _dump(dump),
+          _dropped(dropped),
+          _dumped(dump_paths(*flof, _mod_name, dump)),
+          // a dedup module's internals are spread over its instances, so
+          // they have to be listed rather than dumped as one scope
+          _dump_scope(dump.internal && dump.signals.empty() && !dump.dedup),
+          _cycle(0),
+          _dump_started(false),
+          _dump_on(false)
+    {
+        std::string clk_name = _mod_name + "_clk";
+        std::string reset_name = _mod_name + "_reset";
 
         out << "`timescale 1ps/1ps\n"
-                  << "module " << mod_name << "_tb();\n";
+                  << "module " << _mod_name << "_tb();\n";
 
         std::vector<nodeptr> inputs;
         std::vector<nodeptr> outputs;
         std::vector<nodeptr> ports;
 
-        std::map<std::string, unsigned int> sizemap;
-
         for (const auto &op : flof->operations()) {
-            if (op->op() == opcode::IN) {
-                inputs.push_back(op->d());
-                ports.push_back(op->d());
-                sizemap[node_name(op->d())] = op->d()->width();
-            } else if (op->op() == opcode::OUT) {
-                outputs.push_back(op->d());
-                ports.push_back(op->d());
+            switch (op.op()) {
+            case opcode::IN:
+                inputs.push_back(op.d());
+                ports.push_back(op.d());
+                _sizemap[node_name(op.d())] = op.d()->width();
+                break;
+            case opcode::OUT:
+                outputs.push_back(op.d());
+                ports.push_back(op.d());
+                break;
+            default:
+                break;
             }
         }
 
@@ -387,7 +592,7 @@ namespace flo2v {
             out << "wire [" << (node->width() - 1) << ":0] "
                       << node_name(node) << ";\n";
 
-        out << mod_name << " " << mod_name << " (\n"
+        out << _mod_name << " " << _mod_name << " (\n"
                   << "\t." << clk_name << " (clk),\n"
                   << "\t." << reset_name << " (reset)";
 
@@ -400,33 +605,147 @@ namespace flo2v {
         out << "\n);\n";
 
         out << "initial begin\n\t";
+    }
 
-        for (const auto &act : stepf->actions()) {
-            unsigned int width;
+    unsigned int tb_writer::width(const std::string &signal)
+    {
+        auto it = _sizemap.find(signal);
+        if (it != _sizemap.end())
+            return it->second;
+
+        if (_dropped.count(signal) == 0) {
+            fprintf(stderr, "Step file pokes %s, which isn't an input\n",
+                    signal.c_str());
+            exit(EXIT_FAILURE);
+        }
+        return 0;
+    }
+
+    void tb_writer::step(size_t cycles)
+    {
+        // split the delay at every window edge it crosses so the
+        // dump can be switched on and off at the right time
+        while (_dump_started && !_dump.windows.empty()) {
+            size_t edge = next_window_edge(_dump, _cycle);
+            if (edge == 0 || edge - _cycle > cycles)
+                break;
+
+            _out << "#" << _clock_period * (edge - _cycle) << " ";
+            cycles -= edge - _cycle;
+            _cycle = edge;
+
+            if (in_window(_dump, _cycle) != _dump_on) {
+                _dump_on = !_dump_on;
+                _out << (_dump_on ? "$dumpon" : "$dumpoff") << ";\n\t";
+            }
+        }
+        _cycle += cycles;
+        if (cycles > 0)
+            _out << "#" << _clock_period * cycles << " ";
+    }
+
+    void tb_writer::poke(const std::string &signal, const std::string &literal)
+    {
+        _out << signal << " <= " << literal << ";\n\t";
+    }
+
+    void tb_writer::reset(size_t cycles)
+    {
+        _out << "reset <= 1;\n\t#" << _clock_period * cycles
+                  << " reset <= 0;\n"
+                  << "\t$dumpfile(\"" << _mod_name << "-test.vcd\");\n";
+        if (_dump_scope)
+            _out << "\t$dumpvars(1, " << _mod_name << ");\n\t";
+        else
+            gen_vardump(_out, _dumped);
+        _dump_started = true;
+        _dump_on = in_window(_dump, _cycle);
+        if (!_dump_on)
+            _out << "$dumpoff;\n\t";
+    }
+
+    void tb_writer::quit(void)
+    {
+        _out << "$finish;\n";
+    }
+
+    void tb_writer::close(void)
+    {
+        _out << "end\nendmodule\n";
+    }
+
+    void gen_step(std::shared_ptr<ir::graph> flof,
+                  std::shared_ptr<libstep::step> stepf, size_t clock_period,
+                  std::ostream &out, const dump_options &dump,
+                  const std::set<std::string> &dropped_inputs)
+    {
+        tb_writer tb(flof, clock_period, out, dump, dropped_inputs);
+        unsigned int width;
 
+        for (const auto &act : stepf->actions()) {
             switch (act->at()) {
             case libstep::action_type::STEP:
-                out << "#" << clock_period * act->cycles() << " ";
+                tb.step(act->cycles());
                 break;
             case libstep::action_type::WIRE_POKE:
-                width = sizemap[act->signal()];
-                out << act->signal() << " <= "
-                          << width << "'d" << act->value() << ";\n\t";
+                width = tb.width(act->signal());
+                if (width > 0)
+                    tb.poke(act->signal(), std::to_string(width)
+                            + "'d" + act->value());
                 break;
             case libstep::action_type::RESET:
-                out << "reset <= 1;\n\t#" << clock_period * act->cycles()
-                          << " reset <= 0;\n"
-                          << "\t$dumpfile(\"" << mod_name << "-test.vcd\");\n";
-                gen_vardump(out, mod_name, ports);
+                tb.reset(act->cycles());
                 break;
             case libstep::action_type::QUIT:
-                out << "$finish;\n";
+                tb.quit();
                 break;
             default:
                 break;
             }
         }
 
-        out << "end\nendmodule\n";
+        tb.close();
+    }
+
+    void gen_step(std::shared_ptr<ir::graph> flof,
+                  libstep::binary_step &stepf, size_t clock_period,
+                  std::ostream &out, const dump_options &dump,
+                  const std::set<std::string> &dropped_inputs)
+    {
+        tb_writer tb(flof, clock_period, out, dump, dropped_inputs);
+
+        // resolve the widths once per signal rather than once per poke
+        auto &signals = stepf.signals();
+        std::vector<std::string> prefixes;
+        for (const auto &signal : signals) {
+            auto width = tb.width(signal.second);
+            prefixes.push_back(width > 0 ?
+                    std::to_string(width) + "'h" : "");
+        }
+
+        for (const auto &rec : stepf) {
+            switch (rec.at) {
+            case libstep::action_type::STEP:
+                tb.step(rec.cycles);
+                break;
+            case libstep::action_type::WIRE_POKE:
+                if (rec.signal >= signals.size())
+                    throw libstep::malformed_exception();
+                if (prefixes[rec.signal] != "")
+                    tb.poke(signals[rec.signal].second,
+                            prefixes[rec.signal] + rec.value_hex());
+                break;
+            case libstep::action_type::RESET:
+                tb.reset(rec.cycles);
+                break;
+            case libstep::action_type::QUIT:
+                tb.quit();
+                break;
+            default:
+                break;
+            }
+        }
+
+        tb.close();
     }
 }
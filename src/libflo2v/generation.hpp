@@ -1,20 +1,62 @@
 #ifndef FLO2V_GENERATION_H
 #define FLO2V_GENERATION_H
 
-#include <libflo/flo.h++>
-#include <libflo/node.h++>
-#include <libflo/operation.h++>
+#include "ir.hpp"
 #include <libstep/step.hpp>
+#include <libstep/binary.hpp>
 #include <ostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
 
 using namespace libflo;
 
 namespace flo2v {
-    void gen_flo(std::shared_ptr<flo<node, operation<node> > > flof,
-                 std::ostream &out);
-    void gen_step(std::shared_ptr<flo<node, operation<node> > > flof,
+    /**
+     * Controls which nets a generated testbench dumps and when.  Signal
+     * patterns are shell-style globs matched against either the flo or the
+     * Verilog name of a net; an empty list selects every candidate.  Windows
+     * are half-open [start, end) ranges counted in step cycles, and an empty
+     * list dumps the whole trace after reset.  Internal nets (registers and
+     * wires of the generated module) are only candidates when requested,
+     * and dedup says the module was generated with repeated logic pulled
+     * out into instances, which is where those nets then have to be found.
+     */
+    struct dump_options {
+        std::vector<std::string> signals;
+        std::vector<std::pair<size_t, size_t> > windows;
+        bool internal;
+        bool dedup;
+
+        dump_options(void) : internal(false), dedup(false) {}
+    };
+
+    /* The nets a testbench generated with these options dumps.  If this
+     * is empty there's nothing worth dumping, as $dumpvars with no nets
+     * would dump the testbench itself. */
+    std::vector<const ir::node *> dumped_nets(const ir::graph &flof,
+                                              const dump_options &dump);
+
+    /* With dedup set, logic repeated under different hierarchy
+     * prefixes is generated once as a submodule and instantiated. */
+    void gen_flo(std::shared_ptr<ir::graph> flof,
+                 std::ostream &out, bool dedup = false);
+    /* Pokes to dropped_inputs (those that slicing removed) are left out
+     * of the testbench, but poking any other input the module doesn't
+     * have is an error. */
+    void gen_step(std::shared_ptr<ir::graph> flof,
                   std::shared_ptr<libstep::step> stepf, size_t clock_period,
-                  std::ostream &out);
+                  std::ostream &out,
+                  const dump_options &dump = dump_options(),
+                  const std::set<std::string> &dropped_inputs =
+                      std::set<std::string>());
+    void gen_step(std::shared_ptr<ir::graph> flof,
+                  libstep::binary_step &stepf, size_t clock_period,
+                  std::ostream &out,
+                  const dump_options &dump = dump_options(),
+                  const std::set<std::string> &dropped_inputs =
+                      std::set<std::string>());
 }
 
 #endif
@@ -1,23 +1,23 @@
 #ifndef FLO2V_HELPERS_H
 #define FLO2V_HELPERS_H
 
-#include <libflo/flo.h++>
-#include <libflo/node.h++>
-#include <libflo/operation.h++>
+#include "ir.hpp"
 
-using namespace libflo;
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
 
 namespace flo2v {
 
-    typedef std::shared_ptr<node> nodeptr;
-    typedef std::shared_ptr<operation<node> > opptr;
+    typedef const ir::node *nodeptr;
+    typedef const ir::operation *opptr;
 
     // find the name of the top-level module for this flo file
-    const std::string class_name(
-            std::shared_ptr<flo<node, operation<node> > > &flof)
+    inline const std::string class_name(const ir::graph &flof)
     {
-        for (const auto& node: flof->nodes()) {
-            std::string name = node->name();
+        for (const auto& node: flof.nodes()) {
+            std::string name = node.name();
             size_t index = name.find(":");
             if (index == std::string::npos)
                 continue;
@@ -33,7 +33,7 @@ namespace flo2v {
     /**
      * convert a flo node into an equivalent Verilog expression
      */
-    const std::string node_name(nodeptr node)
+    inline const std::string node_name(nodeptr node)
     {
         std::string name = node->name();
         std::vector<std::string> sections;
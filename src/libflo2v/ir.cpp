@@ -0,0 +1,195 @@
+#include "ir.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+using namespace libflo;
+
+namespace flo2v {
+    namespace ir {
+        struct mnemonic {
+            const char *name;
+            opcode op;
+        };
+
+        static const mnemonic mnemonics[] = {
+            { "add", opcode::ADD },
+            { "sub", opcode::SUB },
+            { "mul", opcode::MUL },
+            { "div", opcode::DIV },
+            { "and", opcode::AND },
+            { "or", opcode::OR },
+            { "xor", opcode::XOR },
+            { "lsh", opcode::LSH },
+            { "rsh", opcode::RSH },
+            { "rshd", opcode::RSHD },
+            { "arsh", opcode::ARSH },
+            { "eq", opcode::EQ },
+            { "gte", opcode::GTE },
+            { "lt", opcode::LT },
+            { "neq", opcode::NEQ },
+            { "neg", opcode::NEG },
+            { "not", opcode::NOT },
+            { "log2", opcode::LOG2 },
+            { "mov", opcode::MOV },
+            { "out", opcode::OUT },
+            { "in", opcode::IN },
+            { "cat", opcode::CAT },
+            { "catd", opcode::CATD },
+            { "mux", opcode::MUX },
+            { "rd", opcode::RD },
+            { "wr", opcode::WR },
+            { "init", opcode::INIT },
+            { "reg", opcode::REG },
+            { "mem", opcode::MEM },
+            { "rst", opcode::RST },
+        };
+
+        const char *opcode_name(opcode op)
+        {
+            for (const auto &m : mnemonics) {
+                if (m.op == op)
+                    return m.name;
+            }
+            return "?";
+        }
+
+        bool parse_opcode(const char *ptr, size_t len, opcode &op)
+        {
+            for (const auto &m : mnemonics) {
+                if (strlen(m.name) == len && memcmp(m.name, ptr, len) == 0) {
+                    op = m.op;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        operation::operation(const graph *g, opcode op,
+                             const std::vector<node_id> &args)
+            : _graph(g),
+              _op(op),
+              _argc(args.size() < max_args ? args.size() : max_args)
+        {
+            for (size_t i = 0; i < _argc; i++)
+                _args[i] = args[i];
+        }
+
+        const node *operation::arg(size_t i) const
+        {
+            if (i >= _argc)
+                return NULL;
+            return &_graph->at(_args[i]);
+        }
+
+        std::shared_ptr<graph> graph::from_libflo(
+                std::shared_ptr<flo<libflo::node,
+                    libflo::operation<libflo::node> > > flof)
+        {
+            std::shared_ptr<graph> g(new graph());
+            std::unordered_map<const libflo::node *, node_id> ids;
+
+            auto intern = [&](std::shared_ptr<libflo::node> n) {
+                auto it = ids.find(n.get());
+                if (it != ids.end())
+                    return it->second;
+                auto id = g->add_node(node(n->name(), n->width(),
+                                           n->known_width(), n->is_const(),
+                                           n->is_mem(), n->depth()));
+                ids[n.get()] = id;
+                return id;
+            };
+
+            // keep libflo's node order, so memories come out the same
+            for (const auto &n : flof->nodes())
+                intern(n);
+
+            for (const auto &op : flof->operations()) {
+                std::vector<node_id> args;
+                std::shared_ptr<libflo::node> ptrs[] = {
+                    op->d(), op->s(), op->t(), op->u(), op->v()
+                };
+                for (const auto &ptr : ptrs) {
+                    if (ptr == NULL)
+                        break;
+                    args.push_back(intern(ptr));
+                }
+                g->add_operation(op->op(), args);
+            }
+
+            return g;
+        }
+
+        static bool same_node(const node *a, const node *b)
+        {
+            return a->name() == b->name()
+                && a->known_width() == b->known_width()
+                && (!a->known_width() || a->width() == b->width())
+                && a->is_const() == b->is_const()
+                && a->is_mem() == b->is_mem()
+                && (!a->is_mem() || a->depth() == b->depth());
+        }
+
+        static void describe(std::ostream &log, const node *n)
+        {
+            log << n->name() << "/";
+            if (n->known_width())
+                log << n->width();
+            else
+                log << "?";
+            if (n->is_mem())
+                log << "[" << n->depth() << "]";
+        }
+
+        static void describe(std::ostream &log, const operation &op)
+        {
+            describe(log, op.d());
+            log << " = " << opcode_name(op.op());
+            for (size_t i = 1; i < op.argc(); i++) {
+                log << " ";
+                describe(log, op.arg(i));
+            }
+        }
+
+        bool cross_check(const graph &a, const graph &b, std::ostream &log)
+        {
+            const size_t max_reported = 20;
+            size_t differences = 0;
+
+            if (a.operations().size() != b.operations().size()) {
+                log << "operation counts differ: "
+                    << a.operations().size() << " != "
+                    << b.operations().size() << "\n";
+                differences++;
+            }
+
+            size_t count = std::min(a.operations().size(),
+                                    b.operations().size());
+            for (size_t i = 0; i < count; i++) {
+                const auto &x = a.operations()[i];
+                const auto &y = b.operations()[i];
+                bool same = x.op() == y.op() && x.argc() == y.argc();
+                for (size_t j = 0; same && j < x.argc(); j++)
+                    same = same_node(x.arg(j), y.arg(j));
+                if (same)
+                    continue;
+
+                if (++differences > max_reported)
+                    continue;
+                log << "operation " << i << " differs:\n\t";
+                describe(log, x);
+                log << "\n\t";
+                describe(log, y);
+                log << "\n";
+            }
+
+            if (differences > max_reported)
+                log << (differences - max_reported)
+                    << " more differences not shown\n";
+
+            return differences == 0;
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef FLO2V_IR_H
+#define FLO2V_IR_H
+
+#include <libflo/flo.h++>
+#include <libflo/node.h++>
+#include <libflo/operation.h++>
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace flo2v {
+    namespace ir {
+        typedef uint32_t node_id;
+
+        class graph;
+
+        /* A net of the design, with the same accessors as a libflo
+         * node so the generators don't care where it came from. */
+        class node {
+            protected:
+                std::string _name;
+                size_t _width;
+                size_t _depth;
+                bool _known_width;
+                bool _is_const;
+                bool _is_mem;
+            public:
+                node(const std::string name, size_t width, bool known_width,
+                     bool is_const, bool is_mem, size_t depth) :
+                    _name(name),
+                    _width(width),
+                    _depth(depth),
+                    _known_width(known_width),
+                    _is_const(is_const),
+                    _is_mem(is_mem) {}
+                const std::string& name(void) const { return _name; }
+                size_t width(void) const { return _width; }
+                bool known_width(void) const { return _known_width; }
+                bool is_const(void) const { return _is_const; }
+                bool is_mem(void) const { return _is_mem; }
+                size_t depth(void) const { return _depth; }
+                void set_width(size_t width)
+                {
+                    _width = width;
+                    _known_width = true;
+                }
+                void set_mem(size_t depth)
+                {
+                    _is_mem = true;
+                    _depth = depth;
+                }
+        };
+
+        /* An operation refers to its destination and up to four sources
+         * by their index in the graph's node table. */
+        class operation {
+            public:
+                static const size_t max_args = 5;
+            protected:
+                const graph *_graph;
+                libflo::opcode _op;
+                uint8_t _argc;
+                node_id _args[max_args];
+            public:
+                operation(const graph *g, libflo::opcode op,
+                          const std::vector<node_id> &args);
+                libflo::opcode op(void) const { return _op; }
+                size_t argc(void) const { return _argc; }
+                node_id arg_id(size_t i) const { return _args[i]; }
+                const node *arg(size_t i) const;
+                const node *d(void) const { return arg(0); }
+                const node *s(void) const { return arg(1); }
+                const node *t(void) const { return arg(2); }
+                const node *u(void) const { return arg(3); }
+                const node *v(void) const { return arg(4); }
+        };
+
+        /* A whole flo file as two flat tables.  Operations point back at
+         * the graph, so graphs are only ever handled by pointer. */
+        class graph {
+            protected:
+                std::vector<node> _nodes;
+                std::vector<operation> _operations;
+            public:
+                graph(void) {}
+                graph(const graph &) = delete;
+                graph& operator=(const graph &) = delete;
+
+                const std::vector<node>& nodes(void) const { return _nodes; }
+                const std::vector<operation>& operations(void) const
+                {
+                    return _operations;
+                }
+                node& at(node_id id) { return _nodes[id]; }
+                const node& at(node_id id) const { return _nodes[id]; }
+                node_id id(const node *n) const { return n - &_nodes[0]; }
+
+                node_id add_node(const node &n)
+                {
+                    _nodes.push_back(n);
+                    return _nodes.size() - 1;
+                }
+                void add_operation(libflo::opcode op,
+                                   const std::vector<node_id> &args)
+                {
+                    _operations.push_back(operation(this, op, args));
+                }
+                void reserve(size_t nodes, size_t operations)
+                {
+                    _nodes.reserve(nodes);
+                    _operations.reserve(operations);
+                }
+
+                /* Copies a graph that libflo has parsed. */
+                static std::shared_ptr<graph> from_libflo(
+                        std::shared_ptr<libflo::flo<libflo::node,
+                            libflo::operation<libflo::node> > > flof);
+        };
+
+        /* Maps between opcodes and their flo mnemonics. */
+        const char *opcode_name(libflo::opcode op);
+        bool parse_opcode(const char *ptr, size_t len, libflo::opcode &op);
+
+        /* Reports every difference between two graphs, operation by
+         * operation and comparing nodes by name, returning true if there
+         * were none. */
+        bool cross_check(const graph &a, const graph &b, std::ostream &log);
+    }
+}
+
+#endif
@@ -0,0 +1,440 @@
+#include "reader.hpp"
+#include "libutil/exceptions.hpp"
+#include "libutil/mapped_file.hpp"
+#include "libutil/parallel.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace libflo;
+
+namespace flo2v {
+    // constants aren't interned, their argument slots hold an index into
+    // the chunk's constant table with this bit set
+    static const uint32_t const_bit = 0x80000000;
+
+    struct slice {
+        const char *ptr;
+        size_t len;
+        size_t hash;
+
+        bool operator==(const slice &other) const
+        {
+            return len == other.len && memcmp(ptr, other.ptr, len) == 0;
+        }
+    };
+
+    struct slice_hash {
+        size_t operator()(const slice &s) const { return s.hash; }
+    };
+
+    static size_t hash_bytes(const char *ptr, size_t len)
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < len; i++) {
+            hash ^= (unsigned char) ptr[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    /* Hands out a provisional id per distinct name.  The table is split
+     * into shards with a lock each so threads rarely contend. */
+    class intern_table {
+        protected:
+            static const size_t shard_count = 256;
+            struct shard {
+                std::mutex lock;
+                std::unordered_map<slice, uint32_t, slice_hash> ids;
+            };
+            shard _shards[shard_count];
+            std::atomic<uint32_t> _next;
+        public:
+            intern_table(void) : _next(0) {}
+            uint32_t intern(const char *ptr, size_t len)
+            {
+                slice s = { ptr, len, hash_bytes(ptr, len) };
+                auto &sh = _shards[(s.hash >> 32) % shard_count];
+                std::lock_guard<std::mutex> guard(sh.lock);
+                auto it = sh.ids.find(s);
+                if (it != sh.ids.end())
+                    return it->second;
+                uint32_t id = _next++;
+                sh.ids[s] = id;
+                return id;
+            }
+            size_t size(void) const { return _next; }
+            /* Only safe once every thread is done interning. */
+            std::vector<slice> names(void)
+            {
+                std::vector<slice> names(_next);
+                for (auto &sh : _shards) {
+                    for (const auto &entry : sh.ids)
+                        names[entry.second] = entry.first;
+                }
+                return names;
+            }
+    };
+
+    /* An operation as it was tokenized, before nodes have their final
+     * numbering. */
+    struct raw_op {
+        opcode op;
+        uint8_t argc;
+        bool has_width;
+        uint32_t width;
+        uint32_t args[ir::operation::max_args];
+    };
+
+    struct chunk {
+        const char *begin;
+        const char *end;
+        std::vector<raw_op> ops;
+        std::vector<slice> consts;
+        std::string error;
+    };
+
+    static bool is_blank(char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    static bool is_const_token(const char *ptr)
+    {
+        return (*ptr >= '0' && *ptr <= '9') || *ptr == '-';
+    }
+
+    static void tokenize_chunk(chunk &c, intern_table &names)
+    {
+        const char *pos = c.begin;
+        std::vector<slice> tokens;
+
+        while (pos < c.end) {
+            const char *eol = (const char *) memchr(pos, '\n', c.end - pos);
+            if (eol == NULL)
+                eol = c.end;
+
+            tokens.clear();
+            for (const char *p = pos; p < eol; ) {
+                while (p < eol && is_blank(*p))
+                    p++;
+                if (p == eol)
+                    break;
+                slice tok = { p, 0, 0 };
+                while (p < eol && !is_blank(*p))
+                    p++;
+                tok.len = p - tok.ptr;
+                tokens.push_back(tok);
+            }
+
+            const char *line = pos;
+            pos = eol + 1;
+            if (tokens.empty())
+                continue;
+
+            auto fail = [&](const char *why) {
+                c.error = std::string(why) + ": "
+                    + std::string(line, eol - line);
+            };
+
+            if (tokens.size() < 3 || tokens[1].len != 1
+                || tokens[1].ptr[0] != '=') {
+                fail("Malformed line");
+                return;
+            }
+            if (tokens.size() - 2 > ir::operation::max_args) {
+                fail("Too many arguments");
+                return;
+            }
+
+            raw_op op;
+            const slice &opw = tokens[2];
+            const char *slash = (const char *) memchr(opw.ptr, '/', opw.len);
+            size_t mnemonic_len = slash ? slash - opw.ptr : opw.len;
+            if (!ir::parse_opcode(opw.ptr, mnemonic_len, op.op)) {
+                fail("Unsupported opcode");
+                return;
+            }
+
+            op.has_width = slash != NULL;
+            op.width = 0;
+            if (slash) {
+                for (const char *p = slash + 1; p < opw.ptr + opw.len; p++) {
+                    if (*p < '0' || *p > '9') {
+                        fail("Bad width");
+                        return;
+                    }
+                    op.width = op.width * 10 + (*p - '0');
+                }
+            }
+
+            op.argc = 0;
+            for (size_t i = 0; i < tokens.size(); i++) {
+                if (i == 1 || i == 2)
+                    continue;
+                const slice &tok = tokens[i];
+                if (i > 0 && is_const_token(tok.ptr)) {
+                    op.args[op.argc++] = const_bit | c.consts.size();
+                    c.consts.push_back(tok);
+                } else {
+                    op.args[op.argc++] = names.intern(tok.ptr, tok.len);
+                }
+            }
+
+            c.ops.push_back(op);
+        }
+    }
+
+    /* One pass of filling in the widths that aren't written in the file:
+     * destinations of operations that didn't give one, and constants
+     * whose width is implied by what they're combined with.  Returns the
+     * number of widths that were filled in. */
+    static size_t infer_widths_pass(ir::graph &g)
+    {
+        size_t inferred = 0;
+
+        for (const auto &op : g.operations()) {
+            auto &d = g.at(op.arg_id(0));
+            auto known = [&](size_t i) {
+                return i < op.argc() && op.arg(i)->known_width();
+            };
+
+            if (!d.known_width()) {
+                switch (op.op()) {
+                case opcode::EQ:
+                case opcode::NEQ:
+                case opcode::LT:
+                case opcode::GTE:
+                case opcode::RST:
+                    d.set_width(1);
+                    break;
+                case opcode::ADD:
+                case opcode::SUB:
+                case opcode::DIV:
+                case opcode::AND:
+                case opcode::OR:
+                case opcode::XOR:
+                case opcode::NOT:
+                case opcode::NEG:
+                case opcode::MOV:
+                case opcode::OUT:
+                case opcode::RSH:
+                case opcode::RSHD:
+                case opcode::ARSH:
+                    if (known(1))
+                        d.set_width(op.s()->width());
+                    break;
+                case opcode::MUL:
+                case opcode::CAT:
+                case opcode::CATD:
+                    if (known(1) && known(2))
+                        d.set_width(op.s()->width() + op.t()->width());
+                    break;
+                // the value for a mux and a register, the memory for a
+                // read or write
+                case opcode::MUX:
+                case opcode::REG:
+                case opcode::RD:
+                case opcode::WR:
+                    if (known(2))
+                        d.set_width(op.t()->width());
+                    break;
+                case opcode::INIT:
+                    if (known(1))
+                        d.set_width(op.s()->width());
+                    break;
+                // lsh and log2 widths depend on values rather than widths,
+                // and ins and mems have to give theirs
+                default:
+                    break;
+                }
+
+                if (d.known_width())
+                    inferred++;
+            }
+
+            for (size_t i = 1; i < op.argc(); i++) {
+                auto &arg = g.at(op.arg_id(i));
+                if (!arg.is_const() || arg.known_width())
+                    continue;
+
+                switch (op.op()) {
+                case opcode::ADD:
+                case opcode::SUB:
+                case opcode::AND:
+                case opcode::OR:
+                case opcode::XOR:
+                case opcode::MOV:
+                case opcode::OUT:
+                case opcode::NOT:
+                case opcode::NEG:
+                    if (d.known_width())
+                        arg.set_width(d.width());
+                    break;
+                case opcode::MUL:
+                case opcode::DIV:
+                case opcode::EQ:
+                case opcode::NEQ:
+                case opcode::LT:
+                case opcode::GTE:
+                    if (known(3 - i))
+                        arg.set_width(op.arg(3 - i)->width());
+                    break;
+                case opcode::MUX:
+                    if (i == 1)
+                        arg.set_width(1);
+                    else if (d.known_width())
+                        arg.set_width(d.width());
+                    break;
+                case opcode::REG:
+                    if (i == 1)
+                        arg.set_width(1);
+                    else if (d.known_width())
+                        arg.set_width(d.width());
+                    break;
+                case opcode::RD:
+                case opcode::WR:
+                    if (i == 1)
+                        arg.set_width(1);
+                    else if (i == 4 && d.known_width())
+                        arg.set_width(d.width());
+                    break;
+                default:
+                    break;
+                }
+
+                if (arg.known_width())
+                    inferred++;
+            }
+        }
+
+        return inferred;
+    }
+
+    /* Operations may use a node before the one that defines it, so keep
+     * going until nothing changes.  Any net that's still without a width
+     * can't be declared, so that's fatal. */
+    static void infer_widths(ir::graph &g)
+    {
+        while (infer_widths_pass(g) > 0)
+            ;
+
+        bool unknown = false;
+        for (const auto &n : g.nodes()) {
+            if (n.is_const() || n.known_width())
+                continue;
+            fprintf(stderr, "Unable to infer the width of %s\n",
+                    n.name().c_str());
+            unknown = true;
+        }
+
+        if (unknown)
+            exit(EXIT_FAILURE);
+    }
+
+    std::shared_ptr<ir::graph> read_flo(const std::string filename,
+                                        size_t threads)
+    {
+        std::unique_ptr<libutil::mapped_file> file;
+        try {
+            file.reset(new libutil::mapped_file(filename));
+        } catch (const libutil::nofile_exception &) {
+            fprintf(stderr, "Unable to open %s\n", filename.c_str());
+            exit(EXIT_FAILURE);
+        }
+
+        const char *data = file->data();
+        size_t size = file->size();
+
+        if (threads == 0)
+            threads = 1;
+
+        // split into a few chunks per thread, each ending at a newline
+        std::vector<chunk> chunks;
+        const char *begin = data;
+        const char *end = data + size;
+        size_t count = threads * 4;
+        for (size_t i = 1; i <= count && begin < end; i++) {
+            const char *split = data + size * i / count;
+            if (split < begin)
+                split = begin;
+            const char *eol = (const char *) memchr(split, '\n', end - split);
+            split = (i == count || eol == NULL) ? end : eol + 1;
+
+            chunk c;
+            c.begin = begin;
+            c.end = split;
+            chunks.push_back(c);
+            begin = split;
+        }
+
+        intern_table names;
+        libutil::parallel_for(chunks.size(), threads, [&](size_t i) {
+            tokenize_chunk(chunks[i], names);
+        });
+
+        for (const auto &c : chunks) {
+            if (c.error != "") {
+                fprintf(stderr, "%s\n", c.error.c_str());
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        // Renumber the nodes in the order they first appear in the file,
+        // and build the operations on top of them.
+        auto provisional = names.names();
+        std::vector<uint32_t> remap(provisional.size(), UINT32_MAX);
+        std::shared_ptr<ir::graph> g(new ir::graph());
+
+        size_t op_count = 0, const_count = 0;
+        for (const auto &c : chunks) {
+            op_count += c.ops.size();
+            const_count += c.consts.size();
+        }
+        g->reserve(provisional.size() + const_count, op_count);
+
+        std::vector<ir::node_id> args;
+        for (const auto &c : chunks) {
+            for (const auto &op : c.ops) {
+                args.clear();
+                for (size_t i = 0; i < op.argc; i++) {
+                    uint32_t arg = op.args[i];
+                    if (arg & const_bit) {
+                        const auto &s = c.consts[arg & ~const_bit];
+                        args.push_back(g->add_node(ir::node(
+                            std::string(s.ptr, s.len), 0, false,
+                            true, false, 0)));
+                        continue;
+                    }
+                    if (remap[arg] == UINT32_MAX) {
+                        const auto &s = provisional[arg];
+                        remap[arg] = g->add_node(ir::node(
+                            std::string(s.ptr, s.len), 0, false,
+                            false, false, 0));
+                    }
+                    args.push_back(remap[arg]);
+                }
+
+                auto &d = g->at(args[0]);
+                if (op.has_width)
+                    d.set_width(op.width);
+                if (op.op == opcode::MEM && args.size() > 1)
+                    d.set_mem(strtoul(g->at(args[1]).name().c_str(),
+                                      NULL, 10));
+
+                g->add_operation(op.op, args);
+            }
+        }
+
+        infer_widths(*g);
+        return g;
+    }
+}
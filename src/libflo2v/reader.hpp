@@ -0,0 +1,26 @@
+#ifndef FLO2V_READER_H
+#define FLO2V_READER_H
+
+#include "ir.hpp"
+
+#include <memory>
+#include <string>
+
+namespace flo2v {
+    /**
+     * Reads a flo file straight into the IR without going through libflo.
+     * The file is mmap()ed and split at line boundaries into chunks that
+     * are tokenized in parallel, with node names interned through a table
+     * shared by all the threads.  Nodes are then numbered in the order
+     * they first appear, so the result doesn't depend on the scheduling.
+     *
+     * Constants get a node per use, with the widths of those feeding
+     * width-preserving operations inferred from the other operands.  On a
+     * malformed file this prints the offending line and exits, and the
+     * same goes for any net whose width can't be worked out.
+     */
+    std::shared_ptr<ir::graph> read_flo(const std::string filename,
+                                        size_t threads);
+}
+
+#endif
@@ -0,0 +1,127 @@
+#include "slice.hpp"
+#include "helpers.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace libflo;
+
+namespace flo2v {
+    static const size_t no_op = (size_t) -1;
+
+    std::shared_ptr<ir::graph> slice_outputs(
+            const ir::graph &flof, const std::vector<std::string> &outputs)
+    {
+        const auto &ops = flof.operations();
+        std::vector<size_t> defs(flof.nodes().size(), no_op);
+        std::vector<std::vector<size_t> > writers(flof.nodes().size());
+
+        // Find which operation drives each node, and which operations
+        // write to each memory.
+        for (size_t i = 0; i < ops.size(); i++) {
+            switch (ops[i].op()) {
+            case opcode::WR:
+                writers[ops[i].arg_id(2)].push_back(i);
+                break;
+            case opcode::INIT:
+                writers[ops[i].arg_id(1)].push_back(i);
+                break;
+            default:
+                defs[ops[i].arg_id(0)] = i;
+            }
+        }
+
+        std::vector<bool> keep(ops.size(), false);
+        std::vector<size_t> work;
+
+        for (const auto &name : outputs) {
+            bool found = false;
+            for (size_t i = 0; i < ops.size(); i++) {
+                if (ops[i].op() != opcode::OUT)
+                    continue;
+                auto d = ops[i].d();
+                if (d->name() != name && node_name(d) != name)
+                    continue;
+                if (!keep[i]) {
+                    keep[i] = true;
+                    work.push_back(i);
+                }
+                found = true;
+            }
+            if (!found) {
+                fprintf(stderr, "No output named %s\n", name.c_str());
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        // Walk backwards from the outputs through whatever drives each
+        // operand.  A memory is driven both by its declaration and by
+        // every write to it.
+        auto mark = [&](size_t op) {
+            if (op != no_op && !keep[op]) {
+                keep[op] = true;
+                work.push_back(op);
+            }
+        };
+        while (!work.empty()) {
+            size_t i = work.back();
+            work.pop_back();
+
+            for (size_t a = 1; a < ops[i].argc(); a++) {
+                auto id = ops[i].arg_id(a);
+                mark(defs[id]);
+                if (flof.at(id).is_mem()) {
+                    for (const auto w : writers[id])
+                        mark(w);
+                }
+            }
+        }
+
+        // Copy over what's left, keeping the original order of both the
+        // nodes and the operations.
+        std::vector<bool> used(flof.nodes().size(), false);
+        for (size_t i = 0; i < ops.size(); i++) {
+            if (!keep[i])
+                continue;
+            for (size_t a = 0; a < ops[i].argc(); a++)
+                used[ops[i].arg_id(a)] = true;
+        }
+
+        std::shared_ptr<ir::graph> sliced(new ir::graph());
+        std::vector<ir::node_id> remap(flof.nodes().size());
+        for (size_t n = 0; n < flof.nodes().size(); n++) {
+            if (used[n])
+                remap[n] = sliced->add_node(flof.nodes()[n]);
+        }
+
+        std::vector<ir::node_id> args;
+        for (size_t i = 0; i < ops.size(); i++) {
+            if (!keep[i])
+                continue;
+            args.clear();
+            for (size_t a = 0; a < ops[i].argc(); a++)
+                args.push_back(remap[ops[i].arg_id(a)]);
+            sliced->add_operation(ops[i].op(), args);
+        }
+
+        return sliced;
+    }
+
+    std::set<std::string> dropped_inputs(const ir::graph &flof,
+                                         const ir::graph &sliced)
+    {
+        std::set<std::string> kept;
+        for (const auto &op : sliced.operations()) {
+            if (op.op() == opcode::IN)
+                kept.insert(node_name(op.d()));
+        }
+
+        std::set<std::string> dropped;
+        for (const auto &op : flof.operations()) {
+            if (op.op() == opcode::IN && kept.count(node_name(op.d())) == 0)
+                dropped.insert(node_name(op.d()));
+        }
+        return dropped;
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef FLO2V_SLICE_H
+#define FLO2V_SLICE_H
+
+#include "ir.hpp"
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace flo2v {
+    /**
+     * Builds a copy of a graph that only contains the transitive fan-in
+     * cone of the named OUT ports, following registers and memories (a
+     * read pulls in every write to the memory).  Every other output, and
+     * any input the cone doesn't read, is dropped.  Names may be given
+     * either as in the flo or as in the generated Verilog; an unknown
+     * name is an error.
+     */
+    std::shared_ptr<ir::graph> slice_outputs(
+            const ir::graph &flof, const std::vector<std::string> &outputs);
+
+    /* The Verilog names of the inputs that slicing a graph removed. */
+    std::set<std::string> dropped_inputs(const ir::graph &flof,
+                                         const ir::graph &sliced);
+}
+
+#endif
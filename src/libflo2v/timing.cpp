@@ -0,0 +1,266 @@
+#include "timing.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <utility>
+
+using namespace libflo;
+
+namespace flo2v {
+    static const size_t none = (size_t) -1;
+
+    static size_t clog2(size_t n)
+    {
+        size_t bits = 0;
+        while (((size_t) 1 << bits) < n)
+            bits++;
+        return bits;
+    }
+
+    /* Operations that start a path rather than continue one. */
+    static bool is_source(opcode op)
+    {
+        switch (op) {
+        case opcode::IN:
+        case opcode::REG:
+        case opcode::MEM:
+        case opcode::WR:
+        case opcode::INIT:
+        case opcode::RST:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /* Levels of logic an operation adds, roughly how the generated
+     * Verilog would synthesize. */
+    static size_t op_cost(const ir::operation &op)
+    {
+        size_t width = op.d()->width();
+        size_t in_width = op.argc() > 1 ? op.s()->width() : width;
+
+        switch (op.op()) {
+        case opcode::ADD:
+        case opcode::SUB:
+        case opcode::NEG:
+            return clog2(width) + 1;
+        case opcode::MUL:
+            return 2 * clog2(width) + 1;
+        case opcode::DIV:
+            return width * (clog2(width) + 1);
+        case opcode::AND:
+        case opcode::OR:
+        case opcode::XOR:
+        case opcode::NOT:
+        case opcode::MUX:
+            return 1;
+        case opcode::EQ:
+        case opcode::NEQ:
+            return clog2(in_width) + 1;
+        case opcode::LT:
+        case opcode::GTE:
+            return clog2(in_width) + 1;
+        case opcode::LSH:
+        case opcode::RSH:
+        case opcode::RSHD:
+        case opcode::ARSH:
+            // constant shifts are just wiring
+            if (op.t()->is_const())
+                return 0;
+            return clog2(std::max(width, in_width));
+        case opcode::LOG2:
+            // see gen_log2(), this is a chain of muxes
+            return in_width > 1 ? in_width - 1 : 0;
+        case opcode::RD:
+            return clog2(op.t()->depth());
+        default:
+            return 0;
+        }
+    }
+
+    timing_report analyze_timing(const ir::graph &flof, size_t top)
+    {
+        const auto &ops = flof.operations();
+        const size_t count = flof.nodes().size();
+        std::vector<size_t> driver(count, none);
+        std::vector<size_t> depth(count, 0);
+        std::vector<size_t> pred(count, none);
+        std::vector<unsigned char> state(count, 0);
+
+        for (size_t i = 0; i < ops.size(); i++) {
+            if (!is_source(ops[i].op()))
+                driver[ops[i].arg_id(0)] = i;
+        }
+
+        // Depth-first over the combinational operations with an explicit
+        // stack, since chains in big designs are far deeper than the call
+        // stack would like.
+        bool warned = false;
+        std::vector<std::pair<ir::node_id, size_t> > stack;
+        for (ir::node_id root = 0; root < count; root++) {
+            if (state[root] != 0)
+                continue;
+            stack.push_back(std::make_pair(root, 1));
+            state[root] = 1;
+
+            while (!stack.empty()) {
+                auto &top_entry = stack.back();
+                auto n = top_entry.first;
+                size_t i = driver[n];
+
+                if (i != none && top_entry.second < ops[i].argc()) {
+                    auto arg = ops[i].arg_id(top_entry.second++);
+                    if (state[arg] == 0) {
+                        state[arg] = 1;
+                        stack.push_back(std::make_pair(arg, 1));
+                    } else if (state[arg] == 1 && !warned) {
+                        fprintf(stderr, "Combinational loop through %s\n",
+                                flof.at(arg).name().c_str());
+                        warned = true;
+                    }
+                    continue;
+                }
+
+                if (i != none) {
+                    // constants are always at depth 0, and would start
+                    // a path at a literal rather than a port or register
+                    size_t deepest = 0;
+                    for (size_t a = 1; a < ops[i].argc(); a++) {
+                        auto arg = ops[i].arg_id(a);
+                        if (flof.at(arg).is_mem() || flof.at(arg).is_const()
+                            || state[arg] != 2)
+                            continue;
+                        if (pred[n] == none || depth[arg] > deepest) {
+                            deepest = depth[arg];
+                            pred[n] = arg;
+                        }
+                    }
+                    depth[n] = deepest + op_cost(ops[i]);
+                }
+                state[n] = 2;
+                stack.pop_back();
+            }
+        }
+
+        // paths end wherever a value leaves the combinational logic
+        std::vector<std::pair<size_t, std::pair<ir::node_id, size_t> > > ends;
+        std::vector<size_t> fanout(count, 0);
+        for (size_t i = 0; i < ops.size(); i++) {
+            const auto &op = ops[i];
+            for (size_t a = 1; a < op.argc(); a++) {
+                auto arg = op.arg_id(a);
+                fanout[arg]++;
+                if (op.op() != opcode::OUT && op.op() != opcode::REG
+                    && op.op() != opcode::WR)
+                    continue;
+                if (flof.at(arg).is_mem() || flof.at(arg).is_const())
+                    continue;
+                ends.push_back(std::make_pair(depth[arg],
+                        std::make_pair(arg, i)));
+            }
+        }
+
+        std::stable_sort(ends.begin(), ends.end(),
+            [](const std::pair<size_t, std::pair<ir::node_id, size_t> > &a,
+               const std::pair<size_t, std::pair<ir::node_id, size_t> > &b) {
+                return a.first > b.first;
+            });
+
+        timing_report report;
+        for (size_t e = 0; e < ends.size() && e < top; e++) {
+            timing_path path;
+            const auto &end = ops[ends[e].second.second];
+            path.kind = ir::opcode_name(end.op());
+            path.endpoint = end.arg_id(0);
+            for (size_t n = ends[e].second.first; n != none; n = pred[n]) {
+                path.nodes.push_back(n);
+                path.depths.push_back(depth[n]);
+            }
+            std::reverse(path.nodes.begin(), path.nodes.end());
+            std::reverse(path.depths.begin(), path.depths.end());
+            report.paths.push_back(path);
+        }
+
+        for (ir::node_id n = 0; n < count; n++) {
+            if (fanout[n] == 0 || flof.at(n).is_const())
+                continue;
+            timing_fanout f = { n, fanout[n] };
+            report.fanouts.push_back(f);
+        }
+        std::stable_sort(report.fanouts.begin(), report.fanouts.end(),
+            [](const timing_fanout &a, const timing_fanout &b) {
+                return a.fanout > b.fanout;
+            });
+        if (report.fanouts.size() > top)
+            report.fanouts.resize(top);
+
+        return report;
+    }
+
+    void print_timing(const ir::graph &flof, const timing_report &report,
+                      std::ostream &out)
+    {
+        out << "Deepest paths:\n";
+        for (size_t p = 0; p < report.paths.size(); p++) {
+            const auto &path = report.paths[p];
+            out << "  " << (p + 1) << ". depth " << path.depths.back()
+                << " into " << path.kind << " "
+                << flof.at(path.endpoint).name() << "\n";
+            for (size_t i = 0; i < path.nodes.size(); i++) {
+                const auto &n = flof.at(path.nodes[i]);
+                out << "       " << path.depths[i] << "\t" << n.name()
+                    << " [" << n.width() << "]\n";
+            }
+        }
+
+        out << "Highest fanout:\n";
+        for (size_t f = 0; f < report.fanouts.size(); f++) {
+            const auto &n = flof.at(report.fanouts[f].node);
+            out << "  " << (f + 1) << ". " << report.fanouts[f].fanout
+                << "\t" << n.name() << " [" << n.width() << "]\n";
+        }
+    }
+
+    static std::string json_string(const std::string &s)
+    {
+        std::string out = "\"";
+        for (const auto c : s) {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    void print_timing_json(const ir::graph &flof,
+                           const timing_report &report, std::ostream &out)
+    {
+        out << "{\n  \"paths\": [";
+        for (size_t p = 0; p < report.paths.size(); p++) {
+            const auto &path = report.paths[p];
+            out << (p == 0 ? "" : ",") << "\n    {\"kind\": "
+                << json_string(path.kind) << ", \"endpoint\": "
+                << json_string(flof.at(path.endpoint).name())
+                << ", \"depth\": " << path.depths.back()
+                << ", \"nodes\": [";
+            for (size_t i = 0; i < path.nodes.size(); i++) {
+                const auto &n = flof.at(path.nodes[i]);
+                out << (i == 0 ? "" : ", ") << "{\"name\": "
+                    << json_string(n.name()) << ", \"width\": "
+                    << n.width() << ", \"depth\": " << path.depths[i]
+                    << "}";
+            }
+            out << "]}";
+        }
+
+        out << "\n  ],\n  \"fanout\": [";
+        for (size_t f = 0; f < report.fanouts.size(); f++) {
+            const auto &n = flof.at(report.fanouts[f].node);
+            out << (f == 0 ? "" : ",") << "\n    {\"name\": "
+                << json_string(n.name()) << ", \"width\": " << n.width()
+                << ", \"fanout\": " << report.fanouts[f].fanout << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef FLO2V_TIMING_H
+#define FLO2V_TIMING_H
+
+#include "ir.hpp"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace flo2v {
+    /* A combinational path, from the source it starts at to the net that
+     * ends it, with the logic depth accumulated at each net.  The endpoint
+     * is the output, register or write that the path feeds. */
+    struct timing_path {
+        std::string kind;
+        ir::node_id endpoint;
+        std::vector<ir::node_id> nodes;
+        std::vector<size_t> depths;
+    };
+
+    struct timing_fanout {
+        ir::node_id node;
+        size_t fanout;
+    };
+
+    struct timing_report {
+        std::vector<timing_path> paths;
+        std::vector<timing_fanout> fanouts;
+    };
+
+    /**
+     * Estimates the logic depth of every net by walking the combinational
+     * dataflow, which starts at ports, registers and memories and ends at
+     * outputs, register inputs and memory writes.  Each operation costs a
+     * number of levels that depends on its opcode and width: an adder is
+     * logarithmic in its width, for example, while a LOG2 is a chain of
+     * muxes as long as its input is wide.  The top deepest paths and the
+     * top highest-fanout nets are kept.
+     */
+    timing_report analyze_timing(const ir::graph &flof, size_t top);
+
+    void print_timing(const ir::graph &flof, const timing_report &report,
+                      std::ostream &out);
+    void print_timing_json(const ir::graph &flof,
+                           const timing_report &report, std::ostream &out);
+}
+
+#endif
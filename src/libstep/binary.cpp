@@ -0,0 +1,255 @@
+#include "libstep/binary.hpp"
+#include "libstep/exceptions.hpp"
+
+#include <climits>
+#include <cstring>
+#include <fstream>
+
+namespace libstep {
+    static const char magic[8] = { 'S', 'T', 'E', 'P', 'B', '\0', 1, 0 };
+
+    static void write_varint(std::ostream &stream, size_t value)
+    {
+        while (value >= 0x80) {
+            stream.put((char) ((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        stream.put((char) value);
+    }
+
+    static size_t read_varint(const unsigned char *&pos,
+                              const unsigned char *end)
+    {
+        size_t value = 0;
+        unsigned int shift = 0;
+
+        while (pos < end && shift < 64) {
+            unsigned char byte = *pos++;
+            value |= (size_t) (byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+            shift += 7;
+        }
+        throw malformed_exception();
+    }
+
+    static void write_string(std::ostream &stream, const std::string &s)
+    {
+        write_varint(stream, s.size());
+        stream.write(s.data(), s.size());
+    }
+
+    static std::string read_string(const unsigned char *&pos,
+                                   const unsigned char *end)
+    {
+        size_t len = read_varint(pos, end);
+        if ((size_t) (end - pos) < len)
+            throw malformed_exception();
+        std::string s((const char *) pos, len);
+        pos += len;
+        return s;
+    }
+
+    /* Converts a decimal string into little-endian bytes, with no trailing
+     * zero bytes (so zero is empty). */
+    static std::vector<unsigned char> decimal_to_bytes(
+            const std::string &value)
+    {
+        std::vector<unsigned char> bytes;
+
+        if (value.empty())
+            throw malformed_exception();
+
+        for (const auto c : value) {
+            if (c < '0' || c > '9')
+                throw malformed_exception();
+
+            unsigned int carry = c - '0';
+            for (auto &byte : bytes) {
+                unsigned int v = byte * 10 + carry;
+                byte = v & 0xff;
+                carry = v >> 8;
+            }
+            if (carry > 0)
+                bytes.push_back(carry);
+        }
+
+        return bytes;
+    }
+
+    std::string binary_record::value_decimal(void) const
+    {
+        std::vector<unsigned char> digits(value, value + value_bytes);
+        std::string out;
+
+        // repeatedly divide the big-endian view of the value by ten
+        while (!digits.empty()) {
+            unsigned int rem = 0;
+            for (size_t i = digits.size(); i-- > 0; ) {
+                unsigned int v = (rem << 8) | digits[i];
+                digits[i] = v / 10;
+                rem = v % 10;
+            }
+            out.push_back('0' + rem);
+            while (!digits.empty() && digits.back() == 0)
+                digits.pop_back();
+        }
+
+        if (out.empty())
+            return "0";
+        return std::string(out.rbegin(), out.rend());
+    }
+
+    std::string binary_record::value_hex(void) const
+    {
+        static const char hex[] = "0123456789abcdef";
+        std::string out;
+
+        for (size_t i = value_bytes; i-- > 0; ) {
+            if (out.empty() && value[i] < 0x10) {
+                if (value[i] != 0)
+                    out.push_back(hex[value[i]]);
+                continue;
+            }
+            out.push_back(hex[value[i] >> 4]);
+            out.push_back(hex[value[i] & 0xf]);
+        }
+
+        if (out.empty())
+            return "0";
+        return out;
+    }
+
+    binary_writer::binary_writer(std::ostream &stream,
+                                 const std::vector<signal_name> &signals)
+        : _stream(stream)
+    {
+        _stream.write(magic, sizeof(magic));
+        write_varint(_stream, signals.size());
+        for (size_t i = 0; i < signals.size(); i++) {
+            const auto &signal = signals[i];
+            _index[signal.first + "." + signal.second] = i;
+            write_string(_stream, signal.first);
+            write_string(_stream, signal.second);
+        }
+    }
+
+    void binary_writer::write(action &act)
+    {
+        std::map<std::string, size_t>::iterator it;
+        std::vector<unsigned char> bytes;
+
+        _stream.put((char) act.at());
+
+        switch (act.at()) {
+        case action_type::STEP:
+        case action_type::RESET:
+            write_varint(_stream, act.cycles());
+            break;
+        case action_type::WIRE_POKE:
+            it = _index.find(act.module() + "." + act.signal());
+            if (it == _index.end())
+                throw malformed_exception();
+            bytes = decimal_to_bytes(act.value());
+            write_varint(_stream, it->second);
+            write_varint(_stream, bytes.size());
+            _stream.write((const char *) bytes.data(), bytes.size());
+            break;
+        case action_type::QUIT:
+            break;
+        }
+    }
+
+    binary_step::iterator::iterator(const unsigned char *pos,
+                                    const unsigned char *end)
+        : _pos(pos), _end(end), _next(pos)
+    {
+        if (_pos != _end)
+            decode();
+    }
+
+    void binary_step::iterator::decode(void)
+    {
+        const unsigned char *pos = _pos;
+        size_t cycles;
+
+        _record.at = (action_type) *pos++;
+        _record.cycles = 0;
+        _record.signal = 0;
+        _record.value = NULL;
+        _record.value_bytes = 0;
+
+        switch (_record.at) {
+        case action_type::STEP:
+        case action_type::RESET:
+            // actions count cycles in an unsigned int
+            cycles = read_varint(pos, _end);
+            if (cycles > UINT_MAX)
+                throw malformed_exception();
+            _record.cycles = cycles;
+            break;
+        case action_type::WIRE_POKE:
+            _record.signal = read_varint(pos, _end);
+            _record.value_bytes = read_varint(pos, _end);
+            if ((size_t) (_end - pos) < _record.value_bytes)
+                throw malformed_exception();
+            _record.value = pos;
+            pos += _record.value_bytes;
+            break;
+        case action_type::QUIT:
+            break;
+        default:
+            throw malformed_exception();
+        }
+
+        _next = pos;
+    }
+
+    binary_step::iterator& binary_step::iterator::operator++(void)
+    {
+        _pos = _next;
+        if (_pos != _end)
+            decode();
+        return *this;
+    }
+
+    binary_step::binary_step(const std::string filename)
+        : _file(filename),
+          _base((const unsigned char *) _file.data()),
+          _body(0)
+    {
+        if (_file.size() < sizeof(magic)
+            || memcmp(_base, magic, sizeof(magic)) != 0)
+            throw malformed_exception();
+
+        const unsigned char *pos = _base + sizeof(magic);
+        const unsigned char *end = _base + _file.size();
+        size_t count = read_varint(pos, end);
+        for (size_t i = 0; i < count; i++) {
+            auto module = read_string(pos, end);
+            auto signal = read_string(pos, end);
+            _signals.push_back(signal_name(module, signal));
+        }
+        _body = pos - _base;
+    }
+
+    binary_step::iterator binary_step::begin(void)
+    {
+        return iterator(_base + _body, _base + _file.size());
+    }
+
+    binary_step::iterator binary_step::end(void)
+    {
+        return iterator(_base + _file.size(), _base + _file.size());
+    }
+
+    bool binary_step::is_binary(const std::string filename)
+    {
+        char header[sizeof(magic)];
+        std::ifstream file(filename, std::ios::binary);
+
+        if (!file.read(header, sizeof(header)))
+            return false;
+        return memcmp(header, magic, sizeof(magic)) == 0;
+    }
+}
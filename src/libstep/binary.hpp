@@ -0,0 +1,108 @@
+#ifndef LIBSTEP_BINARY_H
+#define LIBSTEP_BINARY_H
+
+#include "libstep/action.hpp"
+#include "libutil/mapped_file.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <ostream>
+#include <cstddef>
+
+/*
+ * The binary step format (".stepb") is a compiled form of a step file that
+ * can be iterated straight out of an mmap()ed file.  It looks like:
+ *
+ *   magic     "STEPB\0", a format version byte and a reserved zero byte
+ *   varint    number of signals
+ *   per signal: varint length + module name, varint length + signal name
+ *   records until the end of the file, each a one byte action_type tag
+ *     STEP, RESET  varint cycles
+ *     WIRE_POKE    varint signal index, varint byte count, then the value
+ *                  as that many little-endian bytes (so it may be wider
+ *                  than 64 bits)
+ *     QUIT         nothing
+ *
+ * Varints are unsigned LEB128.
+ */
+namespace libstep {
+    typedef std::pair<std::string, std::string> signal_name;
+
+    /* Streams actions out in the binary format.  The signal table has to
+     * be known up front because it lives in the header. */
+    class binary_writer {
+        protected:
+            std::ostream &_stream;
+            std::map<std::string, size_t> _index;
+        public:
+            binary_writer(std::ostream &stream,
+                          const std::vector<signal_name> &signals);
+            void write(action &act);
+    };
+
+    /* One decoded record of a binary step file.  Poke values point
+     * directly into the mapped file. */
+    struct binary_record {
+        action_type at;
+        unsigned int cycles;
+        size_t signal;
+        const unsigned char *value;
+        size_t value_bytes;
+
+        std::string value_decimal(void) const;
+        std::string value_hex(void) const;
+    };
+
+    /* A read-only view of a binary step file that decodes records on the
+     * fly rather than building an action for each of them. */
+    class binary_step {
+        protected:
+            libutil::mapped_file _file;
+            const unsigned char *_base;
+            size_t _body;
+            std::vector<signal_name> _signals;
+        public:
+            class iterator {
+                protected:
+                    const unsigned char *_pos;
+                    const unsigned char *_end;
+                    const unsigned char *_next;
+                    binary_record _record;
+                    void decode(void);
+                public:
+                    iterator(const unsigned char *pos,
+                             const unsigned char *end);
+                    const binary_record& operator*(void) const
+                    {
+                        return _record;
+                    }
+                    const binary_record* operator->(void) const
+                    {
+                        return &_record;
+                    }
+                    iterator& operator++(void);
+                    bool operator!=(const iterator &other) const
+                    {
+                        return _pos != other._pos;
+                    }
+            };
+
+            binary_step(const std::string filename);
+            binary_step(const binary_step &) = delete;
+            binary_step& operator=(const binary_step &) = delete;
+
+            const std::vector<signal_name>& signals(void)
+            {
+                return _signals;
+            }
+            iterator begin(void);
+            iterator end(void);
+
+            /* Checks for the binary magic at the start of a file. */
+            static bool is_binary(const std::string filename);
+    };
+}
+
+#endif
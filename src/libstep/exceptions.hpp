@@ -1,3 +1,8 @@
+#ifndef LIBSTEP_EXCEPTIONS_H
+#define LIBSTEP_EXCEPTIONS_H
+
+#include <exception>
+
 namespace libstep {
     class nofile_exception : public std::exception {
         const char* what() const throw() { return "File not found"; }
@@ -6,3 +11,5 @@ namespace libstep {
         const char* what() const throw() { return "Malformed step file"; }
     };
 }
+
+#endif
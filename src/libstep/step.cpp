@@ -1,10 +1,12 @@
 #include "libstep/step.hpp"
+#include "libstep/binary.hpp"
 #include "libstep/exceptions.hpp"
 
 #include <fstream>
 #include <iostream>
 #include <string>
 #include <sstream>
+#include <map>
 
 namespace libstep {
     static std::vector<std::string> split(
@@ -63,9 +65,37 @@ namespace libstep {
         throw malformed_exception();
     }
 
+    static const std::shared_ptr<step> parse_binary(
+            const std::string filename)
+    {
+        std::shared_ptr<step> stepf(new step());
+        binary_step bin(filename);
+        auto &signals = bin.signals();
+
+        for (const auto &rec : bin) {
+            std::string module, signal;
+            if (rec.at == action_type::WIRE_POKE) {
+                if (rec.signal >= signals.size())
+                    throw malformed_exception();
+                module = signals[rec.signal].first;
+                signal = signals[rec.signal].second;
+            }
+            stepf->add_action(std::shared_ptr<action>(
+                    new action(rec.at, module, signal,
+                        rec.at == action_type::WIRE_POKE ?
+                            rec.value_decimal() : "",
+                        rec.cycles)));
+        }
+
+        return stepf;
+    }
+
     const std::shared_ptr<step> step::parse(
             const std::string filename)
     {
+        if (binary_step::is_binary(filename))
+            return parse_binary(filename);
+
         std::shared_ptr<step> stepf(new step());
         std::ifstream file;
 
@@ -94,4 +124,25 @@ namespace libstep {
             stream << act->to_string() << "\n";
         }
     }
+
+    void step::dump_binary(std::ostream &stream)
+    {
+        std::vector<signal_name> signals;
+        std::map<std::string, bool> seen;
+
+        // intern the signals in the order they're first poked
+        for (const auto &act : _actions) {
+            if (act->at() != action_type::WIRE_POKE)
+                continue;
+            auto fullname = act->module() + "." + act->signal();
+            if (seen[fullname])
+                continue;
+            seen[fullname] = true;
+            signals.push_back(signal_name(act->module(), act->signal()));
+        }
+
+        binary_writer writer(stream, signals);
+        for (const auto &act : _actions)
+            writer.write(*act);
+    }
 }
@@ -19,9 +19,11 @@ namespace libstep {
             {
                 _actions.push_back(act);
             }
+            /* Accepts both text and binary step files. */
             static const std::shared_ptr<step> parse(
                     const std::string filename);
             void dump(std::ostream &stream);
+            void dump_binary(std::ostream &stream);
     };
 }
 
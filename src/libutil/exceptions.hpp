@@ -0,0 +1,12 @@
+#ifndef LIBUTIL_EXCEPTIONS_H
+#define LIBUTIL_EXCEPTIONS_H
+
+#include <exception>
+
+namespace libutil {
+    class nofile_exception : public std::exception {
+        const char* what() const throw() { return "File not found"; }
+    };
+}
+
+#endif
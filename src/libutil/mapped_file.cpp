@@ -0,0 +1,45 @@
+#include "libutil/mapped_file.hpp"
+#include "libutil/exceptions.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace libutil {
+    mapped_file::mapped_file(const std::string filename, bool sequential)
+        : _fd(-1), _data(""), _size(0)
+    {
+        struct stat st;
+
+        _fd = open(filename.c_str(), O_RDONLY);
+        if (_fd < 0)
+            throw nofile_exception();
+
+        if (fstat(_fd, &st) < 0) {
+            close(_fd);
+            throw nofile_exception();
+        }
+
+        _size = st.st_size;
+        if (_size == 0)
+            return;
+
+        void *map = mmap(NULL, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+        if (map == MAP_FAILED) {
+            close(_fd);
+            throw nofile_exception();
+        }
+
+        if (sequential)
+            madvise(map, _size, MADV_SEQUENTIAL);
+        _data = (const char *) map;
+    }
+
+    mapped_file::~mapped_file(void)
+    {
+        if (_size > 0)
+            munmap((void *) _data, _size);
+        close(_fd);
+    }
+}
@@ -0,0 +1,29 @@
+#ifndef LIBUTIL_MAPPED_FILE_H
+#define LIBUTIL_MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+namespace libutil {
+    /* A read-only mmap() of a whole file, which lets parsers hand out
+     * pointers into the file rather than copying every token.  An empty
+     * file maps to an empty buffer, it's up to the caller whether that's
+     * an error. */
+    class mapped_file {
+        protected:
+            int _fd;
+            const char *_data;
+            size_t _size;
+        public:
+            /* Files that will only be read front to back can say so,
+             * which lets the kernel read ahead and drop pages behind. */
+            mapped_file(const std::string filename, bool sequential = false);
+            mapped_file(const mapped_file &) = delete;
+            mapped_file& operator=(const mapped_file &) = delete;
+            ~mapped_file(void);
+            const char *data(void) const { return _data; }
+            size_t size(void) const { return _size; }
+    };
+}
+
+#endif
@@ -0,0 +1,33 @@
+#ifndef LIBUTIL_PARALLEL_H
+#define LIBUTIL_PARALLEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace libutil {
+    /* Runs a job over [0, count) on a pool of worker threads, each of
+     * which takes the next index as soon as it's done with the last. */
+    template<class F>
+    void parallel_for(size_t count, size_t threads, F job)
+    {
+        std::atomic<size_t> next(0);
+        std::vector<std::thread> workers;
+
+        if (threads == 0)
+            threads = 1;
+
+        for (size_t t = 0; t < threads; t++) {
+            workers.push_back(std::thread([&]() {
+                size_t i;
+                while ((i = next++) < count)
+                    job(i);
+            }));
+        }
+        for (auto &worker : workers)
+            worker.join();
+    }
+}
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef LIBVCD_EXCEPTIONS_H
+#define LIBVCD_EXCEPTIONS_H
+
+#include <exception>
+
+namespace libvcd {
+    class nofile_exception : public std::exception {
+        const char* what() const throw() { return "File not found"; }
+    };
+    class malformed_exception : public std::exception {
+        const char* what() const throw() { return "Malformed VCD file"; }
+    };
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include "libvcd/vcd.hpp"
+#include "libvcd/exceptions.hpp"
+
+#include <cstring>
+
+namespace libvcd {
+    static bool is_space(char c)
+    {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+    }
+
+    bool token::operator==(const char *s) const
+    {
+        return strlen(s) == len && memcmp(ptr, s, len) == 0;
+    }
+
+    bool cursor::next_token(token &tok)
+    {
+        while (_pos < _end && is_space(*_pos))
+            _pos++;
+        if (_pos == _end)
+            return false;
+
+        tok.ptr = _pos;
+        while (_pos < _end && !is_space(*_pos))
+            _pos++;
+        tok.len = _pos - tok.ptr;
+        return true;
+    }
+
+    bool cursor::next(event &ev)
+    {
+        token tok;
+
+        while (next_token(tok)) {
+            switch (tok.ptr[0]) {
+            case '#':
+                ev.type = event_type::TIME;
+                ev.time = strtoull(std::string(tok.ptr + 1,
+                                               tok.len - 1).c_str(),
+                                   NULL, 10);
+                return true;
+            case '$':
+                // comments are the only commands with a body to skip
+                if (tok == "$comment") {
+                    while (next_token(tok) && !(tok == "$end"))
+                        ;
+                }
+                break;
+            case 'b':
+            case 'B':
+            case 'r':
+            case 'R':
+                ev.type = event_type::CHANGE;
+                ev.value.ptr = tok.ptr + 1;
+                ev.value.len = tok.len - 1;
+                if (!next_token(ev.id))
+                    throw malformed_exception();
+                return true;
+            case '0':
+            case '1':
+            case 'x':
+            case 'X':
+            case 'z':
+            case 'Z':
+                if (tok.len < 2)
+                    throw malformed_exception();
+                ev.type = event_type::CHANGE;
+                ev.value.ptr = tok.ptr;
+                ev.value.len = 1;
+                ev.id.ptr = tok.ptr + 1;
+                ev.id.len = tok.len - 1;
+                return true;
+            default:
+                throw malformed_exception();
+            }
+        }
+
+        return false;
+    }
+
+    reader::reader(const std::string filename)
+        : _file(filename, true),
+          _body(_file.size())
+    {
+        if (_file.size() == 0)
+            throw malformed_exception();
+
+        cursor decls(_file.data(), _file.data() + _file.size());
+        std::vector<std::string> scopes;
+        token tok;
+
+        while (decls.next_token(tok)) {
+            if (tok == "$scope") {
+                token type, name;
+                if (!decls.next_token(type) || !decls.next_token(name))
+                    throw malformed_exception();
+                scopes.push_back(name.str());
+            } else if (tok == "$upscope") {
+                if (scopes.empty())
+                    throw malformed_exception();
+                scopes.pop_back();
+            } else if (tok == "$var") {
+                token type, size, id, name;
+                if (!decls.next_token(type) || !decls.next_token(size)
+                    || !decls.next_token(id) || !decls.next_token(name))
+                    throw malformed_exception();
+
+                var v;
+                for (const auto &scope : scopes)
+                    v.path += (v.path == "" ? "" : ".") + scope;
+                v.name = name.str();
+                v.name = v.name.substr(0, v.name.find("["));
+                v.id = id.str();
+                v.width = strtoul(size.str().c_str(), NULL, 10);
+                _vars.push_back(v);
+            } else if (tok == "$timescale") {
+                while (decls.next_token(tok) && !(tok == "$end"))
+                    _timescale += tok.str();
+            } else if (tok == "$enddefinitions") {
+                while (decls.next_token(tok) && !(tok == "$end"))
+                    ;
+                _body = decls._pos - _file.data();
+                return;
+            } else if (tok.ptr[0] == '$' && !(tok == "$end")) {
+                // skip the body of anything else ($date, $version, ...)
+                while (decls.next_token(tok) && !(tok == "$end"))
+                    ;
+            }
+        }
+    }
+
+    uint64_t id_key(const char *ptr, size_t len)
+    {
+        uint64_t key = 0;
+
+        if (len > 9)
+            return 0;
+
+        for (size_t i = 0; i < len; i++)
+            key = key * 95 + (unsigned char) (ptr[i] - 32);
+        return key;
+    }
+}
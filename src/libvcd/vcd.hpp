@@ -0,0 +1,96 @@
+#ifndef LIBVCD_VCD_H
+#define LIBVCD_VCD_H
+
+#include "libutil/mapped_file.hpp"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace libvcd {
+    /* A token is just a slice of the mapped file. */
+    struct token {
+        const char *ptr;
+        size_t len;
+
+        bool operator==(const char *s) const;
+        std::string str(void) const { return std::string(ptr, len); }
+    };
+
+    /* A $var declaration.  The path is the dotted scope the variable was
+     * declared in, and the name has any bit range stripped. */
+    struct var {
+        std::string path;
+        std::string name;
+        std::string id;
+        size_t width;
+
+        std::string full_name(void) const
+        {
+            return path == "" ? name : path + "." + name;
+        }
+    };
+
+    /* Things that happen in the body of a dump: either time moves on or a
+     * variable changes.  Values are the bits without the "b" prefix. */
+    enum class event_type {
+        TIME,
+        CHANGE
+    };
+
+    struct event {
+        event_type type;
+        uint64_t time;
+        token id;
+        token value;
+    };
+
+    /* Walks the body of a dump between two offsets, skipping the
+     * simulation commands ($dumpvars and friends) that wrap changes. */
+    class cursor {
+        friend class reader;
+        protected:
+            const char *_pos;
+            const char *_end;
+            bool next_token(token &tok);
+        public:
+            cursor(const char *begin, const char *end)
+                : _pos(begin), _end(end) {}
+            bool next(event &ev);
+    };
+
+    /* Parses the declarations of a dump up front and then hands out
+     * cursors over its body, so the value changes are never held in
+     * memory all at once. */
+    class reader {
+        protected:
+            libutil::mapped_file _file;
+            std::vector<var> _vars;
+            std::string _timescale;
+            size_t _body;
+        public:
+            reader(const std::string filename);
+            const std::vector<var>& vars(void) const { return _vars; }
+            const std::string& timescale(void) const { return _timescale; }
+            const char *body_begin(void) const
+            {
+                return _file.data() + _body;
+            }
+            const char *body_end(void) const
+            {
+                return _file.data() + _file.size();
+            }
+            cursor body(void) const
+            {
+                return cursor(body_begin(), body_end());
+            }
+    };
+
+    /* Packs an identifier code into an integer, which makes for a much
+     * cheaper lookup key than a string.  Codes longer than fit are
+     * reported as 0, which is never a valid key. */
+    uint64_t id_key(const char *ptr, size_t len);
+}
+
+#endif
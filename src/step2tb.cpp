@@ -1,10 +1,15 @@
 #include <libflo/flo.h++>
+#include <getopt.h>
 
 #include <iostream>
 #include <fstream>
+#include <set>
+#include <sstream>
 
 #include "libflo2v/generation.hpp"
+#include "libflo2v/slice.hpp"
 #include "libstep/step.hpp"
+#include "libstep/binary.hpp"
 
 using namespace libflo;
 
@@ -12,26 +17,130 @@ using namespace libflo;
 #define CLOCK_PERIOD 2
 #endif
 
+static void print_help(const char *prog_name)
+{
+    std::cerr << "Usage: " << prog_name << " [options] <step> <flo>\n"
+              << "  --dump-signals <globs>  only dump the comma-separated"
+              << " nets\n"
+              << "  --dump-window <s>:<e>   only dump cycles in [s, e),"
+              << " may be repeated\n"
+              << "  --dump-internal         also dump the module's"
+              << " internal nets\n"
+              << "  --keep-outputs <list>   only drive the inputs that"
+              << " feed these outputs\n"
+              << "  --dedup                 the module was generated with"
+              << " --dedup\n";
+}
+
+/* Parses a "<start>:<end>" cycle window, returning false if it's bogus. */
+static bool parse_window(const std::string &arg,
+                         std::pair<size_t, size_t> &window)
+{
+    auto colon = arg.find(":");
+    if (colon == std::string::npos)
+        return false;
+
+    try {
+        window.first = std::stoul(arg.substr(0, colon));
+        window.second = std::stoul(arg.substr(colon + 1));
+    } catch (const std::exception &e) {
+        return false;
+    }
+
+    return window.first < window.second;
+}
+
 int main(int argc, char *argv[])
 {
-    if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <step> <flo>\n";
+    const struct option long_options[] = {
+        {"dump-signals", 1, NULL, 's'},
+        {"dump-window", 1, NULL, 'w'},
+        {"dump-internal", 0, NULL, 'i'},
+        {"keep-outputs", 1, NULL, 'k'},
+        {"dedup", 0, NULL, 'd'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    flo2v::dump_options dump;
+    std::vector<std::string> keep_outputs;
+
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) > 0) {
+        std::stringstream list;
+        std::string item;
+        std::pair<size_t, size_t> window;
+
+        switch (opt) {
+        case 's':
+            list.str(optarg);
+            while (std::getline(list, item, ','))
+                if (item != "")
+                    dump.signals.push_back(item);
+            break;
+        case 'w':
+            if (!parse_window(optarg, window)) {
+                std::cerr << "Bad dump window " << optarg << "\n";
+                exit(EXIT_FAILURE);
+            }
+            dump.windows.push_back(window);
+            break;
+        case 'i':
+            dump.internal = true;
+            break;
+        case 'd':
+            dump.dedup = true;
+            break;
+        case 'k':
+            list.str(optarg);
+            while (std::getline(list, item, ','))
+                if (item != "")
+                    keep_outputs.push_back(item);
+            break;
+        default:
+            print_help(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (argc - optind < 2) {
+        print_help(argv[0]);
         return -1;
     }
 
-    std::string flopath(argv[2]);
+    std::string flopath(argv[optind + 1]);
     auto dotpos = flopath.rfind(".flo");
     if (dotpos == std::string::npos) {
         fprintf(stderr, "Not a flo file\n");
         exit(EXIT_FAILURE);
     }
     auto outpath = flopath.substr(0, dotpos) + "_tb.v";
+
+    auto flof = flo2v::ir::graph::from_libflo(
+            flo<node, operation<node> >::parse(argv[optind + 1]));
+    std::set<std::string> dropped_inputs;
+    if (!keep_outputs.empty()) {
+        auto sliced = flo2v::slice_outputs(*flof, keep_outputs);
+        dropped_inputs = flo2v::dropped_inputs(*flof, *sliced);
+        flof = sliced;
+    }
+
+    if (flo2v::dumped_nets(*flof, dump).empty()) {
+        fprintf(stderr, "No signals selected for dumping\n");
+        exit(EXIT_FAILURE);
+    }
+
     std::ofstream output(outpath);
 
-    auto stepf = libstep::step::parse(argv[1]);
-    auto flof = flo<node, operation<node> >::parse(argv[2]);
+    // binary step files are streamed straight out of the mapped file
+    if (libstep::binary_step::is_binary(argv[optind])) {
+        libstep::binary_step stepf(argv[optind]);
+        flo2v::gen_step(flof, stepf, CLOCK_PERIOD, output, dump,
+                        dropped_inputs);
+        return 0;
+    }
 
-    flo2v::gen_step(flof, stepf, CLOCK_PERIOD, output);
+    auto stepf = libstep::step::parse(argv[optind]);
+    flo2v::gen_step(flof, stepf, CLOCK_PERIOD, output, dump,
+                    dropped_inputs);
 
     return 0;
 }
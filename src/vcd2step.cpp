@@ -0,0 +1,283 @@
+#include <libflo/flo.h++>
+#include <getopt.h>
+
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <unordered_map>
+
+#include "libflo2v/helpers.hpp"
+#include "libstep/action.hpp"
+#include "libstep/binary.hpp"
+#include "libvcd/vcd.hpp"
+
+using namespace libflo;
+
+static void print_help(const char *prog_name)
+{
+    std::cerr << "Usage: " << prog_name << " [options] <vcd> <flo> <step>\n"
+              << "  --period <n>    VCD time units per cycle (default 1)\n"
+              << "  --reset <name>  name of the reset signal"
+              << " (default reset)\n"
+              << "Writes a binary step file if <step> ends in .stepb\n";
+}
+
+/* Converts a VCD bit string to decimal, treating x and z as 0. */
+static std::string bits_to_decimal(const std::string &bits)
+{
+    if (bits.size() <= 64) {
+        unsigned long long value = 0;
+        for (const auto c : bits)
+            value = (value << 1) | (c == '1' ? 1 : 0);
+        return std::to_string(value);
+    }
+
+    // little-endian decimal digits, doubled and incremented per bit
+    std::vector<unsigned char> digits(1, 0);
+    for (const auto c : bits) {
+        unsigned int carry = (c == '1' ? 1 : 0);
+        for (auto &digit : digits) {
+            unsigned int v = digit * 2 + carry;
+            digit = v % 10;
+            carry = v / 10;
+        }
+        if (carry > 0)
+            digits.push_back(carry);
+    }
+
+    std::string out;
+    for (auto it = digits.rbegin(); it != digits.rend(); ++it)
+        out.push_back('0' + *it);
+    return out;
+}
+
+/* Sends actions to either a text or a binary step file as they are
+ * produced, so nothing is buffered. */
+class step_sink {
+    protected:
+        std::ofstream _file;
+        std::unique_ptr<libstep::binary_writer> _binary;
+    public:
+        step_sink(const std::string path,
+                  const std::vector<libstep::signal_name> &signals)
+            : _file(path, std::ios::binary)
+        {
+            auto dotpos = path.rfind(".stepb");
+            if (dotpos != std::string::npos && dotpos + 6 == path.size())
+                _binary.reset(new libstep::binary_writer(_file, signals));
+        }
+        void emit(libstep::action act)
+        {
+            if (_binary)
+                _binary->write(act);
+            else
+                _file << act.to_string() << "\n";
+        }
+        void step(size_t cycles)
+        {
+            emit(libstep::action(libstep::action_type::STEP,
+                                 "", "", "", cycles));
+        }
+};
+
+struct port {
+    std::string name;
+    std::string last;
+    std::string pending;
+    bool dirty;
+};
+
+int main(int argc, char *argv[])
+{
+    const struct option long_options[] = {
+        {"period", 1, NULL, 'p'},
+        {"reset", 1, NULL, 'r'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    uint64_t period = 1;
+    std::string reset_name = "reset";
+
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) > 0) {
+        switch (opt) {
+        case 'p':
+            period = strtoull(optarg, NULL, 10);
+            if (period == 0) {
+                std::cerr << "Bad period " << optarg << "\n";
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'r':
+            reset_name = optarg;
+            break;
+        default:
+            print_help(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (argc - optind < 3) {
+        print_help(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    auto flof = flo2v::ir::graph::from_libflo(
+            flo<node, operation<node> >::parse(argv[optind + 1]));
+    auto mod_name = flo2v::class_name(*flof);
+    libvcd::reader vcd(argv[optind]);
+
+    std::vector<port> ports;
+    for (const auto &op : flof->operations()) {
+        if (op.op() != opcode::IN)
+            continue;
+        port p;
+        p.name = flo2v::node_name(op.d());
+        p.dirty = false;
+        ports.push_back(p);
+    }
+
+    // Resolve every input port (and the reset) to a VCD identifier once,
+    // preferring the shallowest declaration of each name.  Slot
+    // ports.size() is the reset.
+    const size_t reset_slot = ports.size();
+    std::vector<const libvcd::var *> resolved(ports.size() + 1, NULL);
+    auto depth = [](const libvcd::var *v) {
+        return std::count(v->path.begin(), v->path.end(), '.');
+    };
+    for (const auto &v : vcd.vars()) {
+        for (size_t i = 0; i <= ports.size(); i++) {
+            bool match = (i == reset_slot) ?
+                (v.name == reset_name || v.name == mod_name + "_reset") :
+                (v.name == ports[i].name);
+            if (!match)
+                continue;
+            if (resolved[i] == NULL || depth(&v) < depth(resolved[i]))
+                resolved[i] = &v;
+        }
+    }
+
+    std::unordered_map<uint64_t, std::vector<size_t> > slots;
+    for (size_t i = 0; i <= ports.size(); i++) {
+        if (resolved[i] == NULL) {
+            std::cerr << "No VCD signal for "
+                      << (i == reset_slot ? reset_name : ports[i].name)
+                      << "\n";
+            continue;
+        }
+        auto key = libvcd::id_key(resolved[i]->id.data(),
+                                  resolved[i]->id.size());
+        if (key == 0) {
+            std::cerr << "VCD identifier too long: " << resolved[i]->id
+                      << "\n";
+            exit(EXIT_FAILURE);
+        }
+        slots[key].push_back(i);
+    }
+
+    std::vector<libstep::signal_name> signals;
+    for (const auto &p : ports)
+        signals.push_back(libstep::signal_name(mod_name, p.name));
+    step_sink sink(argv[optind + 2], signals);
+
+    bool reset_level = false;
+    bool reset_seen = false;
+    bool in_reset = false;
+    size_t reset_cycles = 0;
+    size_t pending_steps = 0;
+
+    // Emits a poke for every input whose value changed since it was last
+    // poked, preceded by any steps that have built up.
+    auto flush_pokes = [&]() {
+        for (auto &p : ports) {
+            if (!p.dirty)
+                continue;
+            p.dirty = false;
+
+            auto value = bits_to_decimal(p.pending);
+            if (value == p.last)
+                continue;
+            p.last = value;
+
+            if (pending_steps > 0) {
+                sink.step(pending_steps);
+                pending_steps = 0;
+            }
+            sink.emit(libstep::action(libstep::action_type::WIRE_POKE,
+                                      mod_name, p.name, value, 0));
+        }
+    };
+
+    // Moves time on by some number of cycles.  Inputs that change while
+    // reset is held are all poked before the reset action, as that's the
+    // only point the testbench can apply them, but changes made as reset
+    // falls belong after it.
+    auto advance = [&](size_t cycles) {
+        // step2tb only starts dumping at a reset, so if the dump doesn't
+        // start in reset (or never has one) emit an empty one up front.
+        if (!reset_seen && !reset_level)
+            sink.emit(libstep::action(libstep::action_type::RESET,
+                                      "", "", "", 0));
+        reset_seen = true;
+
+        if (reset_level && !in_reset) {
+            if (pending_steps > 0) {
+                sink.step(pending_steps);
+                pending_steps = 0;
+            }
+            in_reset = true;
+            reset_cycles = 0;
+        }
+        if (in_reset && !reset_level) {
+            sink.emit(libstep::action(libstep::action_type::RESET,
+                                      "", "", "", reset_cycles));
+            in_reset = false;
+        }
+        if (in_reset) {
+            flush_pokes();
+            reset_cycles += cycles;
+            return;
+        }
+        flush_pokes();
+        pending_steps += cycles;
+    };
+
+    auto cursor = vcd.body();
+    libvcd::event ev;
+    uint64_t cycle = 0;
+
+    while (cursor.next(ev)) {
+        if (ev.type == libvcd::event_type::TIME) {
+            uint64_t next = ev.time / period;
+            if (next > cycle) {
+                advance(next - cycle);
+                cycle = next;
+            }
+            continue;
+        }
+
+        auto it = slots.find(libvcd::id_key(ev.id.ptr, ev.id.len));
+        if (it == slots.end())
+            continue;
+
+        for (const auto slot : it->second) {
+            if (slot == reset_slot) {
+                reset_level = (ev.value.len > 0
+                               && ev.value.ptr[ev.value.len - 1] == '1');
+                continue;
+            }
+            ports[slot].pending = ev.value.str();
+            ports[slot].dirty = true;
+        }
+    }
+
+    // a reset that's still held at the end of the dump never falls, so
+    // finish it off here
+    reset_level = false;
+    advance(0);
+    if (pending_steps > 0)
+        sink.step(pending_steps);
+    sink.emit(libstep::action(libstep::action_type::QUIT, "", "", "", 0));
+
+    return 0;
+}
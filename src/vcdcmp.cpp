@@ -0,0 +1,339 @@
+#include <getopt.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "libutil/parallel.hpp"
+#include "libvcd/vcd.hpp"
+
+static void print_help(const char *prog_name)
+{
+    std::cerr << "Usage: " << prog_name << " [options] <reference> <test>\n"
+              << "  --a-tspc <n>      reference time units per cycle"
+              << " (default 1)\n"
+              << "  --b-tspc <n>      test time units per cycle (default 2)\n"
+              << "  --a-prefix <p>    hierarchy stripped from reference"
+              << " signals\n"
+              << "  --b-prefix <p>    hierarchy stripped from test signals\n"
+              << "  --threads <n>     worker threads (default: all cores)\n"
+              << "By default a single top scope is stripped from the"
+              << " reference, and a <mod>_tb.<mod> pair from the test.\n";
+}
+
+/* One value change of one signal, pointing into the mapped dump. */
+struct change {
+    uint64_t time;
+    const char *ptr;
+    size_t len;
+};
+
+typedef std::vector<std::vector<change> > chunk_changes;
+
+/* A dump being compared: its declarations, the signals we care about,
+ * and every change to them split up by the chunk it was parsed from. */
+struct dump {
+    libvcd::reader vcd;
+    std::string prefix;
+    uint64_t tspc;
+    std::unordered_map<uint64_t, std::vector<size_t> > slots;
+    std::vector<chunk_changes> chunks;
+
+    dump(const std::string filename) : vcd(filename), tspc(1) {}
+};
+
+/* Guesses how much hierarchy to strip off of a dump's signals: a top
+ * scope shared by everything, plus "<mod>" under a "<mod>_tb" scope. */
+static std::string default_prefix(const libvcd::reader &vcd)
+{
+    if (vcd.vars().empty())
+        return "";
+
+    auto path = vcd.vars()[0].path;
+    auto top = path.substr(0, path.find("."));
+    for (const auto &v : vcd.vars()) {
+        if (v.path.substr(0, v.path.find(".")) != top)
+            return "";
+    }
+
+    if (top.size() > 3 && top.compare(top.size() - 3, 3, "_tb") == 0) {
+        auto mod = top.substr(0, top.size() - 3);
+        for (const auto &v : vcd.vars()) {
+            if (v.path == top + "." + mod)
+                return top + "." + mod + ".";
+        }
+    }
+    return top + ".";
+}
+
+/* Maps each signal name (with the prefix stripped) to its declaration,
+ * skipping anything that isn't under the prefix. */
+static std::map<std::string, const libvcd::var *> signal_names(dump &d)
+{
+    std::map<std::string, const libvcd::var *> names;
+    for (const auto &v : d.vcd.vars()) {
+        auto name = v.full_name();
+        if (name.compare(0, d.prefix.size(), d.prefix) != 0)
+            continue;
+        names[name.substr(d.prefix.size())] = &v;
+    }
+    return names;
+}
+
+/* Splits a dump's body into roughly equal chunks that each start at a
+ * timestamp, so they can be parsed independently. */
+static std::vector<const char *> split_body(const libvcd::reader &vcd,
+                                            size_t count)
+{
+    const char *begin = vcd.body_begin();
+    const char *end = vcd.body_end();
+    std::vector<const char *> bounds(1, begin);
+
+    for (size_t i = 1; i < count; i++) {
+        const char *pos = begin + (end - begin) * i / count;
+        if (pos < bounds.back())
+            pos = bounds.back();
+        while (pos < end && !(*pos == '#' && pos[-1] == '\n'))
+            pos++;
+        if (pos == end)
+            break;
+        if (pos != bounds.back())
+            bounds.push_back(pos);
+    }
+
+    bounds.push_back(end);
+    return bounds;
+}
+
+static void index_changes(dump &d, size_t signals, size_t threads)
+{
+    auto bounds = split_body(d.vcd, threads * 4);
+    d.chunks.assign(bounds.size() - 1, chunk_changes(signals));
+
+    libutil::parallel_for(d.chunks.size(), threads, [&](size_t i) {
+        libvcd::cursor cursor(bounds[i], bounds[i + 1]);
+        libvcd::event ev;
+        uint64_t time = 0;
+
+        while (cursor.next(ev)) {
+            if (ev.type == libvcd::event_type::TIME) {
+                time = ev.time;
+                continue;
+            }
+
+            auto it = d.slots.find(libvcd::id_key(ev.id.ptr, ev.id.len));
+            if (it == d.slots.end())
+                continue;
+
+            change c = { time, ev.value.ptr, ev.value.len };
+            for (const auto slot : it->second)
+                d.chunks[i][slot].push_back(c);
+        }
+    });
+}
+
+/* VCD drops leading bits that match the extension, so widen values back
+ * out to the width of the signal before comparing them: a leading 1 is
+ * extended with 0, and a leading 0, x or z with itself. */
+static std::string extend(const char *ptr, size_t len, size_t width)
+{
+    std::string value(ptr, len);
+    for (auto &c : value)
+        c = tolower(c);
+
+    // reals aren't bit vectors
+    if (value.empty() || value.find('.') != std::string::npos
+        || value.size() >= width)
+        return value;
+
+    char fill = value[0] == '1' ? '0' : value[0];
+    return std::string(width - value.size(), fill) + value;
+}
+
+/* Flattens a signal's changes into one value per cycle, keeping the last
+ * value that was set during each cycle. */
+static std::vector<std::pair<uint64_t, std::string> > sample(
+        const dump &d, size_t slot, size_t width)
+{
+    std::vector<std::pair<uint64_t, std::string> > samples;
+
+    for (const auto &chunk : d.chunks) {
+        for (const auto &c : chunk[slot]) {
+            uint64_t cycle = c.time / d.tspc;
+            auto value = extend(c.ptr, c.len, width);
+            if (!samples.empty() && samples.back().first == cycle)
+                samples.back().second = value;
+            else
+                samples.push_back(std::make_pair(cycle, value));
+        }
+    }
+
+    return samples;
+}
+
+struct divergence {
+    bool found;
+    uint64_t cycle;
+    std::string a;
+    std::string b;
+};
+
+/* Walks both sampled streams together from the first cycle at which
+ * both dumps have a value, and returns the first cycle they disagree. */
+static divergence compare(const dump &a, const dump &b, size_t slot,
+                          size_t width)
+{
+    auto as = sample(a, slot, width);
+    auto bs = sample(b, slot, width);
+    divergence div;
+    div.found = false;
+
+    if (as.empty() || bs.empty())
+        return div;
+
+    uint64_t start = std::max(as[0].first, bs[0].first);
+    size_t i = 0, j = 0;
+    std::string av, bv;
+
+    while (i < as.size() || j < bs.size()) {
+        uint64_t cycle = UINT64_MAX;
+        if (i < as.size())
+            cycle = std::min(cycle, as[i].first);
+        if (j < bs.size())
+            cycle = std::min(cycle, bs[j].first);
+
+        if (i < as.size() && as[i].first == cycle)
+            av = as[i++].second;
+        if (j < bs.size() && bs[j].first == cycle)
+            bv = bs[j++].second;
+
+        if (cycle < start)
+            continue;
+        if (av != bv) {
+            div.found = true;
+            div.cycle = cycle;
+            div.a = av;
+            div.b = bv;
+            return div;
+        }
+    }
+
+    return div;
+}
+
+int main(int argc, char *argv[])
+{
+    const struct option long_options[] = {
+        {"a-tspc", 1, NULL, 'a'},
+        {"b-tspc", 1, NULL, 'b'},
+        {"a-prefix", 1, NULL, 'A'},
+        {"b-prefix", 1, NULL, 'B'},
+        {"threads", 1, NULL, 't'},
+        {NULL, 0, NULL, 0}
+    };
+    int opt;
+    uint64_t a_tspc = 1, b_tspc = 2;
+    std::string a_prefix, b_prefix;
+    bool a_prefix_set = false, b_prefix_set = false;
+    size_t threads = std::thread::hardware_concurrency();
+
+    while ((opt = getopt_long(argc, argv, "", long_options, NULL)) > 0) {
+        switch (opt) {
+        case 'a':
+            a_tspc = strtoull(optarg, NULL, 10);
+            break;
+        case 'b':
+            b_tspc = strtoull(optarg, NULL, 10);
+            break;
+        case 'A':
+            a_prefix = optarg;
+            a_prefix_set = true;
+            break;
+        case 'B':
+            b_prefix = optarg;
+            b_prefix_set = true;
+            break;
+        case 't':
+            threads = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            print_help(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (argc - optind < 2 || a_tspc == 0 || b_tspc == 0) {
+        print_help(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (threads == 0)
+        threads = 1;
+
+    dump a(argv[optind]);
+    dump b(argv[optind + 1]);
+    a.tspc = a_tspc;
+    b.tspc = b_tspc;
+    a.prefix = a_prefix_set ? a_prefix : default_prefix(a.vcd);
+    b.prefix = b_prefix_set ? b_prefix : default_prefix(b.vcd);
+
+    // only signals that are in both dumps can be compared
+    auto a_names = signal_names(a);
+    auto b_names = signal_names(b);
+    std::vector<std::string> names;
+    std::vector<size_t> widths;
+    for (const auto &entry : b_names) {
+        auto it = a_names.find(entry.first);
+        if (it == a_names.end()) {
+            std::cerr << "Not in reference: " << entry.first << "\n";
+            continue;
+        }
+
+        size_t slot = names.size();
+        names.push_back(entry.first);
+        widths.push_back(std::max(it->second->width, entry.second->width));
+        for (auto d : { std::make_pair(&a, it->second),
+                        std::make_pair(&b, entry.second) }) {
+            auto key = libvcd::id_key(d.second->id.data(),
+                                      d.second->id.size());
+            if (key == 0) {
+                std::cerr << "VCD identifier too long: " << d.second->id
+                          << "\n";
+                exit(EXIT_FAILURE);
+            }
+            d.first->slots[key].push_back(slot);
+        }
+    }
+
+    if (names.empty()) {
+        std::cerr << "No signals in common\n";
+        exit(EXIT_FAILURE);
+    }
+
+    index_changes(a, names.size(), threads);
+    index_changes(b, names.size(), threads);
+
+    std::vector<divergence> results(names.size());
+    libutil::parallel_for(names.size(), threads, [&](size_t i) {
+        results[i] = compare(a, b, i, widths[i]);
+    });
+
+    size_t failed = 0;
+    for (size_t i = 0; i < names.size(); i++) {
+        if (!results[i].found)
+            continue;
+        failed++;
+        std::cout << names[i] << ": differs at cycle " << results[i].cycle
+                  << ": " << results[i].a << " != " << results[i].b << "\n";
+    }
+
+    std::cout << names.size() << " signals compared, " << failed
+              << " differ\n";
+
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+#!/bin/bash
+
+#include "helpers.bash"
+
+set -e
+
+cleanup_sim
+
+# Two copies of the same lane, each with a register and a net that's
+# read from outside of the lane.
+cat > Dedup.flo <<EOF
+Dedup::io_a = in/8
+Dedup::io_en = in/1
+Dedup::lane_0::r = reg/8 Dedup::io_en Dedup::lane_0::n
+Dedup::lane_0::n = add/8 Dedup::lane_0::r Dedup::io_a
+Dedup::lane_0::c = eq/1 Dedup::lane_0::n 3
+Dedup::lane_0::m = mux/8 Dedup::lane_0::c Dedup::lane_0::n 7
+Dedup::lane_1::r = reg/8 Dedup::io_en Dedup::lane_1::n
+Dedup::lane_1::n = add/8 Dedup::lane_1::r Dedup::io_a
+Dedup::lane_1::c = eq/1 Dedup::lane_1::n 3
+Dedup::lane_1::m = mux/8 Dedup::lane_1::c Dedup::lane_1::n 7
+Dedup::x = xor/8 Dedup::lane_0::m Dedup::lane_1::m
+Dedup::io_o = out/8 Dedup::x
+Dedup::io_r = out/8 Dedup::lane_1::r
+EOF
+
+cat > Dedup.step <<EOF
+wire_poke Dedup.io_a 1
+wire_poke Dedup.io_en 1
+reset 2
+step 3
+wire_poke Dedup.io_a 2
+step 5
+wire_poke Dedup.io_en 0
+step 2
+wire_poke Dedup.io_a 200
+wire_poke Dedup.io_en 1
+step 4
+quit
+EOF
+
+# the plain module is the reference
+$FLO2V Dedup.flo > Dedup.v
+$STEP2TB Dedup.step Dedup.flo > Dedup_tb.v
+vcs -full64 -q -o dedup -Mupdate Dedup_tb.v Dedup.v > /dev/null
+./dedup > /dev/null
+mv Dedup-test.vcd Dedup.vcd
+
+$FLO2V --dedup Dedup.flo > Dedup.v
+if [[ "$(grep -c '^module Dedup_dedup' Dedup.v)" != 1 ]]; then
+    echo "Expected exactly one shared submodule"
+    exit 1
+fi
+if [[ "$(grep -c '^Dedup_dedup0 ' Dedup.v)" != 2 ]]; then
+    echo "Expected two instances of the shared submodule"
+    exit 1
+fi
+
+# the lanes' internal nets are only reachable through the instances
+$STEP2TB --dedup --dump-internal Dedup.step Dedup.flo > Dedup_tb.v
+vcs -full64 -q -o dedup -Mupdate Dedup_tb.v Dedup.v > /dev/null
+./dedup > /dev/null
+grep -q 'scope module lane_0_inst' Dedup-test.vcd
+
+$VCDCMP --a-tspc=2 --b-tspc=2 Dedup.vcd Dedup-test.vcd
+
+echo "Test passed"
@@ -1,16 +1,44 @@
 FLO2V="$PWD/bin/flo2v"
 STEP2TB="$PWD/bin/step2tb"
+VCD2STEP="$PWD/bin/vcd2step"
+VCDCMP="$PWD/bin/vcdcmp"
 
 cleanup_sim () {
-    rm -f *.vcd *.v *.step *.flo
-    rm -rf torture torture.daidir
+    rm -f *.vcd *.v *.step *.stepb *.flo
+    rm -rf torture torture.daidir dedup dedup.daidir
 }
 
-run_sim () {
-    $FLO2V Torture.flo > Torture.v
-    vcd2step Torture.vcd Torture.flo Torture.step
-    $STEP2TB Torture.step Torture.flo > Torture_tb.v
+# Builds the testbench from the given step file, simulates it and compares
+# its dump against the reference.  Any further arguments are passed on to
+# step2tb.
+sim_step () {
+    local step="$1"
+    shift
+    $STEP2TB "$@" "$step" Torture.flo > Torture_tb.v
     vcs -full64 -q -o torture -Mupdate Torture_tb.v Torture.v > /dev/null
     ./torture > /dev/null
-    vcddiff --raise-b-signals=1 --b-tspc=2 Torture.vcd Torture-test.vcd
+    $VCDCMP --b-tspc=2 Torture.vcd Torture-test.vcd
+}
+
+# Arguments are passed to both flo2v and step2tb, so they have to be
+# options that both understand (like --dedup)
+run_sim () {
+    $FLO2V "$@" Torture.flo > Torture.v
+    $VCD2STEP Torture.vcd Torture.flo Torture.step
+    sim_step Torture.step "$@"
+}
+
+# The same as run_sim, but through a binary step file
+run_sim_binary () {
+    $FLO2V Torture.flo > Torture.v
+    $VCD2STEP Torture.vcd Torture.flo Torture.stepb
+    sim_step Torture.stepb
+}
+
+# Slices the module down to the cone of its first output, which is then
+# the only output compared
+run_sim_sliced () {
+    local output
+    output="$(grep -m1 ' = out' Torture.flo | cut -d' ' -f1)"
+    run_sim --keep-outputs "$output"
 }
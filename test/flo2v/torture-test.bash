@@ -7,7 +7,17 @@ set -e
 for i in {0..20}; do
     cleanup_sim
     flo-torture --seed "$RANDOM"
+    $FLO2V --cross-check Torture.flo
     run_sim
+    run_sim_binary
+    run_sim_sliced
+done
+
+# again with repeated logic generated as shared submodules
+for i in {0..5}; do
+    cleanup_sim
+    flo-torture --seed "$RANDOM"
+    run_sim --dedup
 done
 
 echo "Test passed"
@@ -0,0 +1,44 @@
+#!/bin/bash
+
+#include "helpers.bash"
+
+set -e
+
+# writes a dump of one 3-bit signal that takes the given values on
+# successive cycles
+write_vcd () {
+    local file="$1"
+    local scale="$2"
+    shift 2
+
+    cat > "$file" <<EOV
+\$timescale 1ps \$end
+\$scope module Cmp \$end
+\$var wire 3 ! v [2:0] \$end
+\$upscope \$end
+\$enddefinitions \$end
+EOV
+    local t=0
+    for value in "$@"; do
+        echo "#$((t * scale))" >> "$file"
+        echo "b$value !" >> "$file"
+        t=$((t + 1))
+    done
+}
+
+cleanup_sim
+
+# leading bits that VCD leaves off are the same value
+write_vcd Cmp.vcd 1 0 1 101 x1
+write_vcd Cmp-test.vcd 2 000 001 101 xx1
+$VCDCMP --b-tspc=2 Cmp.vcd Cmp-test.vcd
+
+# 0x1 is zero-extended, so it isn't xx1
+write_vcd Cmp.vcd 1 0 0x1 1
+write_vcd Cmp-test.vcd 2 0 xx1 1
+if $VCDCMP --b-tspc=2 Cmp.vcd Cmp-test.vcd; then
+    echo "0x1 and xx1 compared equal"
+    exit 1
+fi
+
+echo "Test passed"